@@ -0,0 +1,129 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Advertising ohne Verbindung in Phasen: direkt nach einer Trennung, dem
+// Start oder einem Tastendruck ein sehr kurzes Intervall (der Host findet das
+// Gerät sofort wieder), danach immer längere Intervalle, zum Schluss wahlweise
+// gar keins mehr (Funk aus bis zum nächsten Tastendruck). Die letzte Phase
+// läuft ohne Ende, bis eine Verbindung steht oder der Deep Sleep kommt.
+// Die Klasse entscheidet nur und zählt; Funk und Timer macht remote.cpp.
+namespace adv {
+
+const size_t MAX_PHASES = 4;
+const uint16_t INTERVAL_MIN = 32;      // x0.625 ms = 20 ms, kleinstes erlaubtes Intervall
+const uint16_t INTERVAL_MAX = 16384;   // 10.24 s
+const uint16_t STOP = 0;               // als Intervall: kein Advertising
+
+struct Phase {
+    uint16_t interval;    // x0.625 ms, STOP = aus (nur als letzte Phase)
+    uint16_t durationS;   // bei der letzten Phase ohne Bedeutung
+};
+
+struct Counters {
+    uint16_t entered;     // so oft begonnen
+    uint16_t connected;   // Verbindungen, die in dieser Phase zustande kamen
+    uint32_t activeMs;    // Zeit in dieser Phase
+};
+
+// 1..MAX_PHASES Phasen, Intervalle im erlaubten Bereich, STOP nur zuletzt,
+// jede Phase vor der letzten dauert mindestens 1 s
+inline bool valid(const Phase* phases, size_t n) {
+    if (n < 1 || n > MAX_PHASES) return false;
+    for (size_t i = 0; i < n; i++) {
+        const bool last = i + 1 == n;
+        if (phases[i].interval == STOP ? !last : phases[i].interval < INTERVAL_MIN || phases[i].interval > INTERVAL_MAX)
+            return false;
+        if (!last && phases[i].durationS == 0) return false;
+    }
+    return true;
+}
+
+class Scheduler {
+public:
+    static const uint8_t NONE = 0xFF;
+    static const uint32_t NO_DEADLINE = 0xFFFFFFFF;
+
+    // Neue Folge (nur gültige, siehe valid()). Eine laufende Folge beginnt mit
+    // restart() neu; bis dahin bleibt die aktuelle Phase stehen.
+    void setPhases(const Phase* phases, size_t n) {
+        for (size_t i = 0; i < n; i++) phases_[i] = phases[i];
+        count_ = (uint8_t)n;
+        if (phase_ != NONE && phase_ >= count_) phase_ = count_ - 1;
+    }
+
+    // Trennung, Start oder Tastendruck ohne Verbindung: ab Phase 0. Läuft
+    // Phase 0 schon, beginnt nur ihre Dauer von vorn.
+    void restart(uint32_t nowMs) {
+        if (phase_ != 0) {
+            leave(nowMs);
+            enter(0, nowMs);
+        } else {
+            counters_[0].activeMs += nowMs - phaseStartMs_;
+            phaseStartMs_ = nowMs;
+        }
+        restartMs_ = nowMs;
+    }
+
+    // Verbindung steht: Phase zählt den Erfolg und ruht bis zum nächsten restart()
+    void onConnected(uint32_t nowMs) {
+        if (phase_ == NONE) return;
+        counters_[phase_].connected++;
+        lastReconnectMs_ = nowMs - restartMs_;
+        leave(nowMs);
+        phase_ = NONE;
+    }
+
+    // Fällige Phasenwechsel übernehmen; true, wenn sich das Intervall geändert hat
+    bool update(uint32_t nowMs) {
+        const uint16_t before = interval();
+        while (timeUntilNext(nowMs) == 0) {
+            const uint32_t at = phaseStartMs_ + phases_[phase_].durationS * 1000u;
+            leave(at);
+            enter(phase_ + 1, at);
+        }
+        return interval() != before;
+    }
+
+    uint32_t timeUntilNext(uint32_t nowMs) const {
+        if (phase_ == NONE || phase_ + 1 >= count_) return NO_DEADLINE;
+        const uint32_t duration = phases_[phase_].durationS * 1000u;
+        const uint32_t elapsed = nowMs - phaseStartMs_;
+        return elapsed >= duration ? 0 : duration - elapsed;
+    }
+
+    // Intervall der aktuellen Phase, STOP = kein Advertising (auch ohne Phase)
+    uint16_t interval() const { return phase_ == NONE ? STOP : phases_[phase_].interval; }
+    uint8_t phase() const { return phase_; }
+    size_t count() const { return count_; }
+    // Zeit vom letzten restart() bis zur Verbindung
+    uint32_t lastReconnectMs() const { return lastReconnectMs_; }
+
+    // Zähler einer Phase, die laufende Phase inklusive der Zeit bis nowMs
+    Counters counters(size_t i, uint32_t nowMs) const {
+        Counters c = counters_[i];
+        if (i == phase_) c.activeMs += nowMs - phaseStartMs_;
+        return c;
+    }
+
+private:
+    void enter(uint8_t p, uint32_t nowMs) {
+        phase_ = p;
+        phaseStartMs_ = nowMs;
+        counters_[p].entered++;
+    }
+
+    void leave(uint32_t nowMs) {
+        if (phase_ != NONE) counters_[phase_].activeMs += nowMs - phaseStartMs_;
+    }
+
+    Phase phases_[MAX_PHASES] = {};
+    uint8_t count_ = 0;
+    uint8_t phase_ = NONE;
+    uint32_t phaseStartMs_ = 0;
+    uint32_t restartMs_ = 0;
+    uint32_t lastReconnectMs_ = 0;
+    Counters counters_[MAX_PHASES] = {};
+};
+
+}  // namespace adv
@@ -0,0 +1,120 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Kalibrierfaktor des Spannungsteilers, pro Board per build_flags setzbar:
+//   build_flags = -D BATTERY_DIVIDER=2.3
+// (2.43 = Wemos D1 Mini32 mit unserem Teiler, 2.0 = Standard-Shield)
+#ifndef BATTERY_DIVIDER
+#define BATTERY_DIVIDER 2.43
+#endif
+
+namespace battery {
+
+// Entladekurve einer LiPo-Zelle unter leichter Last (mV -> %)
+struct CurvePoint {
+    uint16_t mv;
+    uint8_t percent;
+};
+
+constexpr CurvePoint LIPO_CURVE[] = {
+    {3300, 0},  {3600, 5},  {3690, 10}, {3710, 15}, {3730, 20}, {3750, 25},
+    {3770, 30}, {3790, 35}, {3800, 40}, {3820, 45}, {3840, 50}, {3850, 55},
+    {3870, 60}, {3910, 65}, {3950, 70}, {3980, 75}, {4020, 80}, {4080, 85},
+    {4110, 90}, {4150, 95}, {4200, 100},
+};
+
+constexpr uint16_t TABLE_MIN_MV = 3300;
+constexpr uint16_t TABLE_MAX_MV = 4200;
+constexpr uint16_t TABLE_STEP_MV = 10;
+constexpr size_t TABLE_SIZE = (TABLE_MAX_MV - TABLE_MIN_MV) / TABLE_STEP_MV + 1;
+
+constexpr uint8_t interpolateCurve(uint16_t mv) {
+    size_t i = 1;
+    while (i < sizeof(LIPO_CURVE) / sizeof(LIPO_CURVE[0]) - 1 && LIPO_CURVE[i].mv < mv) i++;
+    const CurvePoint lo = LIPO_CURVE[i - 1];
+    const CurvePoint hi = LIPO_CURVE[i];
+    if (mv <= lo.mv) return lo.percent;
+    if (mv >= hi.mv) return hi.percent;
+    return lo.percent + (uint8_t)((uint32_t)(mv - lo.mv) * (hi.percent - lo.percent) / (hi.mv - lo.mv));
+}
+
+// Lookup-Tabelle in 10-mV-Schritten, komplett zur Compile-Zeit berechnet
+struct PercentTable {
+    uint8_t values[TABLE_SIZE];
+    constexpr PercentTable() : values() {
+        for (size_t i = 0; i < TABLE_SIZE; i++) values[i] = interpolateCurve(TABLE_MIN_MV + i * TABLE_STEP_MV);
+    }
+};
+
+constexpr PercentTable PERCENT_TABLE{};
+
+constexpr uint8_t percentFromMillivolts(uint16_t mv) {
+    return mv <= TABLE_MIN_MV ? 0
+         : mv >= TABLE_MAX_MV ? 100
+         : PERCENT_TABLE.values[(mv - TABLE_MIN_MV) / TABLE_STEP_MV];
+}
+
+static_assert(percentFromMillivolts(3000) == 0, "Kurve unten");
+static_assert(percentFromMillivolts(4300) == 100, "Kurve oben");
+static_assert(percentFromMillivolts(3840) == 50, "Kurve Mitte");
+
+// Rohwert (12 Bit, 3.3 V Referenz) -> Akkuspannung in mV
+constexpr uint16_t rawToMillivolts(uint16_t raw) {
+    return (uint16_t)(raw * (3300.0 * BATTERY_DIVIDER / 4095.0));
+}
+
+// Inkrementeller Sampler: pro Aufruf von addSample() genau ein ADC-Wert.
+// Über die letzten WINDOW Werte wird der Median gebildet (filtert Ausreißer
+// durch WLAN/BLE-Sendespitzen), darauf läuft ein EMA mit Faktor 1/2^EMA_SHIFT.
+// Mit den Standardwerten bleibt die Spannung ab ready() auf ±50 mV genau bei
+// ADC-Rauschen bis σ 20 LSB und bis 5 % Einbrüchen (`program battery`).
+template <size_t WINDOW = 9, uint8_t EMA_SHIFT = 3>
+class Sampler {
+    static_assert(WINDOW % 2 == 1, "WINDOW muss ungerade sein (Median)");
+
+public:
+    void addSample(uint16_t raw) {
+        window_[next_] = raw;
+        next_ = (next_ + 1) % WINDOW;
+        if (filled_ < WINDOW) filled_++;
+
+        const uint32_t median = (uint32_t)currentMedian() << 8;
+        if (!primed_) {
+            ema_ = median;
+            primed_ = filled_ == WINDOW;
+        } else {
+            ema_ = ema_ + (int32_t)(median - ema_) / (1 << EMA_SHIFT);
+        }
+    }
+
+    // true, sobald das Fenster einmal voll war
+    bool ready() const { return primed_; }
+
+    uint16_t filteredRaw() const { return (uint16_t)((ema_ + 128) >> 8); }
+    uint16_t millivolts() const { return rawToMillivolts(filteredRaw()); }
+    uint8_t percent() const { return percentFromMillivolts(millivolts()); }
+
+private:
+    uint16_t currentMedian() const {
+        uint16_t sorted[WINDOW];
+        for (size_t i = 0; i < filled_; i++) {
+            const uint16_t v = window_[i];
+            size_t j = i;
+            while (j > 0 && sorted[j - 1] > v) {
+                sorted[j] = sorted[j - 1];
+                j--;
+            }
+            sorted[j] = v;
+        }
+        return sorted[filled_ / 2];
+    }
+
+    uint16_t window_[WINDOW] = {};
+    size_t next_ = 0;
+    size_t filled_ = 0;
+    uint32_t ema_ = 0;   // Festkomma, 8 Nachkommabits
+    bool primed_ = false;
+};
+
+}  // namespace battery
@@ -0,0 +1,15 @@
+#pragma once
+#include <cstdint>
+
+// Tasten-IDs, identisch mit den Codes, die an die Bridge-App gehen.
+// Weitere Tasten (BUTTON_KEYS) zählen einfach weiter: 3, 4, ...
+enum ButtonId : uint8_t {
+    BUTTON_NEXT = 1,
+    BUTTON_PREV = 2,
+};
+
+// Ein Flankenereignis, so wie es die ISR aufnimmt
+struct ButtonEvent {
+    uint32_t timeUs;   // esp_timer / micros() zum Zeitpunkt der Flanke
+    uint32_t mask;     // Pegel aller Tasten, Bit (ButtonId - 1) = gedrückt
+};
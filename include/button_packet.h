@@ -0,0 +1,104 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Binärformat der Notifications auf CHAR_BUTTON_UUID (little endian):
+//
+//   [0]    Version (PACKET_VERSION, decode() nimmt auch ältere ab MIN_PACKET_VERSION)
+//   [1]    Anzahl Einträge n (1..MAX_EVENTS)
+//   [2..3] Sequenznummer, +1 pro Notification -> Host erkennt Verluste
+//   [4..7] Gerätezeit in µs (hal::micros) der Flanke des ersten Drucks im
+//          Paket; der Host rechnet sie mit dem Zeitabgleich (time_sync.h)
+//          in seine Zeit um. Weitere Drücke im Paket kamen danach.
+//          Version 1: Gerätezeit in ms beim Kodieren.
+//   danach n x 2 Bytes: Tasten-Code, Wiederholungen
+//
+// Aufeinanderfolgende gleiche Codes werden zu einem Eintrag mit Zähler
+// zusammengefasst. Mit MAX_EVENTS = 6 passt ein volles Paket in die
+// 20 Bytes Nutzlast der Standard-MTU (23). Kein Heap, nur Header.
+namespace packet {
+
+constexpr uint8_t PACKET_VERSION = 2;   // 1: Zeit in ms beim Kodieren
+constexpr uint8_t MIN_PACKET_VERSION = 1;
+constexpr size_t HEADER_SIZE = 8;
+constexpr size_t ENTRY_SIZE = 2;
+constexpr size_t MAX_EVENTS = 6;
+constexpr size_t MAX_PACKET_SIZE = HEADER_SIZE + MAX_EVENTS * ENTRY_SIZE;
+
+struct Entry {
+    uint8_t code;
+    uint8_t repeat;
+};
+
+struct ButtonPacket {
+    uint8_t version = PACKET_VERSION;
+    uint16_t seq = 0;
+    uint32_t timeUs = 0;
+    uint8_t count = 0;
+    Entry entries[MAX_EVENTS] = {};
+
+    bool empty() const { return count == 0; }
+
+    void clear() { count = 0; }
+
+    // Hängt n gleiche Tastendrücke an (Dauerfeuer), edgeUs: Flanke des Drucks.
+    // false, wenn das Paket voll ist.
+    bool add(uint8_t code, uint32_t edgeUs, uint8_t n = 1) {
+        if (count == 0) timeUs = edgeUs;
+        if (count > 0 && entries[count - 1].code == code && entries[count - 1].repeat <= 255 - n) {
+            entries[count - 1].repeat += n;
+            return true;
+        }
+        if (count >= MAX_EVENTS) return false;
+        entries[count++] = {code, n};
+        return true;
+    }
+
+    // Anzahl Tastendrücke inkl. Wiederholungen
+    uint32_t totalPresses() const {
+        uint32_t n = 0;
+        for (uint8_t i = 0; i < count; i++) n += entries[i].repeat;
+        return n;
+    }
+};
+
+inline size_t encodedSize(const ButtonPacket& p) { return HEADER_SIZE + p.count * ENTRY_SIZE; }
+
+// Schreibt das Paket nach out (mind. MAX_PACKET_SIZE Bytes), gibt die Länge zurück
+inline size_t encode(const ButtonPacket& p, uint8_t* out) {
+    out[0] = p.version;
+    out[1] = p.count;
+    out[2] = (uint8_t)(p.seq);
+    out[3] = (uint8_t)(p.seq >> 8);
+    out[4] = (uint8_t)(p.timeUs);
+    out[5] = (uint8_t)(p.timeUs >> 8);
+    out[6] = (uint8_t)(p.timeUs >> 16);
+    out[7] = (uint8_t)(p.timeUs >> 24);
+    uint8_t* e = out + HEADER_SIZE;
+    for (uint8_t i = 0; i < p.count; i++) {
+        *e++ = p.entries[i].code;
+        *e++ = p.entries[i].repeat;
+    }
+    return encodedSize(p);
+}
+
+// Gegenstück für Host-Seite und Tests. false bei ungültigen Daten; liest
+// nie hinter len.
+inline bool decode(const uint8_t* data, size_t len, ButtonPacket& p) {
+    if (len < HEADER_SIZE || data[0] < MIN_PACKET_VERSION || data[0] > PACKET_VERSION) return false;
+    const uint8_t count = data[1];
+    if (count == 0 || count > MAX_EVENTS || len != HEADER_SIZE + count * ENTRY_SIZE) return false;
+    p.version = data[0];
+    p.count = count;
+    p.seq = (uint16_t)(data[2] | (data[3] << 8));
+    p.timeUs = (uint32_t)data[4] | ((uint32_t)data[5] << 8) | ((uint32_t)data[6] << 16) | ((uint32_t)data[7] << 24);
+    const uint8_t* e = data + HEADER_SIZE;
+    for (uint8_t i = 0; i < count; i++) {
+        p.entries[i].code = *e++;
+        p.entries[i].repeat = *e++;
+        if (p.entries[i].repeat == 0) return false;
+    }
+    return true;
+}
+
+}  // namespace packet
@@ -0,0 +1,88 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Tasten als Bitmaske: alle Eingänge kommen mit einem Lesezugriff auf die
+// GPIO-Eingangsregister, Entprellen (debouncer.h) und Flankenerkennung laufen
+// für alle Tasten gleichzeitig mit Bitoperationen. Bit i = Taste i+1 (ButtonId).
+namespace scan {
+
+// Abzug der Eingangsregister des ESP32: GPIO.in (0-31) und GPIO.in1 (32-39)
+struct RawInputs {
+    uint32_t in0;
+    uint32_t in1;
+};
+
+// Aktiv-LOW-Pin aus dem Registerabzug (1 = gedrückt)
+constexpr uint32_t lowBit(const RawInputs& raw, int pin) {
+    return ((pin < 32 ? raw.in0 : raw.in1) >> (pin & 31) & 1u) ^ 1u;
+}
+
+// Bits der Pins in einem der beiden Eingangsregister (word 0: GPIO 0-31, 1: 32-39)
+template <size_t K>
+constexpr uint32_t registerMask(const int (&pins)[K], int word) {
+    uint32_t m = 0;
+    for (size_t i = 0; i < K; i++)
+        if ((pins[i] >> 5) == word) m |= 1u << (pins[i] & 31);
+    return m;
+}
+
+// Direkt angeschlossene Taster gegen GND. Die Pins stehen zur Compile-Zeit
+// fest, damit gather() zu festen Shifts aufgelöst wird.
+template <size_t N>
+struct PinSet {
+    static_assert(N > 0 && N <= 32, "Maske ist 32 Bit breit");
+
+    int pins[N];
+
+    static constexpr size_t size() { return N; }
+
+    // Eingänge, die einen Interrupt brauchen
+    static constexpr size_t inputCount() { return N; }
+    constexpr const int* inputs() const { return pins; }
+
+    constexpr uint32_t gather(const RawInputs& raw) const {
+        uint32_t m = 0;
+        for (size_t i = 0; i < N; i++) m |= lowBit(raw, pins[i]) << i;
+        return m;
+    }
+};
+
+// Optionale Matrix: Zeilen sind Ausgänge, Spalten Eingänge mit Pullup.
+// In Ruhe sind alle Zeilen aktiv (LOW), damit jeder Druck eine Spalte zieht
+// und einen Interrupt auslöst; scan() fragt dann Zeile für Zeile ab.
+// Bit r*C+c = Taste in Zeile r, Spalte c (ohne Dioden keine sicheren Dreier-Kombinationen).
+template <size_t R, size_t C>
+struct Matrix {
+    static_assert(R * C > 0 && R * C <= 32, "Maske ist 32 Bit breit");
+
+    int rows[R];
+    int cols[C];
+
+    static constexpr size_t size() { return R * C; }
+
+    static constexpr size_t inputCount() { return C; }
+    constexpr const int* inputs() const { return cols; }
+
+    constexpr uint32_t columns(const RawInputs& raw) const {
+        uint32_t m = 0;
+        for (size_t c = 0; c < C; c++) m |= lowBit(raw, cols[c]) << c;
+        return m;
+    }
+
+    // drive(pin, aktiv) schaltet eine Zeile, read() liefert den Registerabzug
+    template <class DriveFn, class ReadFn>
+    uint32_t scan(DriveFn drive, ReadFn read) const {
+        for (size_t r = 0; r < R; r++) drive(rows[r], false);
+        uint32_t m = 0;
+        for (size_t r = 0; r < R; r++) {
+            drive(rows[r], true);
+            m |= columns(read()) << (r * C);
+            drive(rows[r], false);
+        }
+        for (size_t r = 0; r < R; r++) drive(rows[r], true);
+        return m;
+    }
+};
+
+}  // namespace scan
@@ -0,0 +1,99 @@
+#pragma once
+#include <cstdint>
+
+// Verbindungsparameter je nach Nutzung: direkt nach einem Tastendruck ein
+// kurzes Intervall (Folgedrücke beim Durchblättern kommen sofort durch),
+// nach einer Ruhephase ein langes Intervall mit Peripheral Latency (spart
+// Energie, das Gerät darf leere Connection Events auslassen).
+// Die Klasse entscheidet nur und zählt; senden und Timer macht remote.cpp.
+namespace conn {
+
+// Einheiten wie in der BLE-Spezifikation: Intervall 1.25 ms, Timeout 10 ms
+struct Params {
+    uint16_t minInterval;
+    uint16_t maxInterval;
+    uint16_t latency;
+    uint16_t timeout;
+};
+
+enum Profile : uint8_t {
+    PROFILE_FAST,
+    PROFILE_IDLE,
+    PROFILE_COUNT,
+    PROFILE_NONE = 0xFF
+};
+
+constexpr Params PROFILES[PROFILE_COUNT] = {
+    {6, 12, 0, 400},    // 7.5-15 ms, keine Latency, 4 s Timeout
+    {80, 120, 4, 600},  // 100-150 ms, 4 Events auslassen, 6 s Timeout
+};
+
+struct Counters {
+    uint16_t requested;
+    uint16_t accepted;
+    uint16_t rejected;
+};
+
+class Manager {
+public:
+    // true, wenn für p jetzt eine Anfrage an den Central gehen soll
+    bool want(Profile p) {
+        if (current_ == p || pending_ == p || refused_[p]) return false;
+        pending_ = p;
+        counters_[p].requested++;
+        return true;
+    }
+
+    // Central hat (neue) Parameter gesetzt, auch ohne eigene Anfrage
+    void onUpdated(uint16_t interval, uint16_t latency) {
+        interval_ = interval;
+        latency_ = latency;
+        current_ = match(interval);
+        if (pending_ == PROFILE_NONE) return;
+        if (current_ == pending_) {
+            counters_[pending_].accepted++;
+        } else {
+            counters_[pending_].rejected++;
+            refused_[pending_] = true;
+        }
+        pending_ = PROFILE_NONE;
+    }
+
+    // Keine Antwort innerhalb der Frist -> gilt als abgelehnt. Bis zur
+    // nächsten Verbindung wird dieses Profil nicht erneut angefragt.
+    void onTimeout() {
+        if (pending_ == PROFILE_NONE) return;
+        counters_[pending_].rejected++;
+        refused_[pending_] = true;
+        pending_ = PROFILE_NONE;
+    }
+
+    void onDisconnect() {
+        current_ = pending_ = PROFILE_NONE;
+        interval_ = latency_ = 0;
+        for (int i = 0; i < PROFILE_COUNT; i++) refused_[i] = false;
+    }
+
+    Profile current() const { return current_; }
+    bool pending() const { return pending_ != PROFILE_NONE; }
+    uint16_t interval() const { return interval_; }
+    uint16_t latency() const { return latency_; }
+    const Counters& counters(Profile p) const { return counters_[p]; }
+
+private:
+    static Profile match(uint16_t interval) {
+        for (int i = 0; i < PROFILE_COUNT; i++) {
+            if (interval >= PROFILES[i].minInterval && interval <= PROFILES[i].maxInterval) return (Profile)i;
+        }
+        return PROFILE_NONE;
+    }
+
+    Profile current_ = PROFILE_NONE;
+    Profile pending_ = PROFILE_NONE;
+    bool refused_[PROFILE_COUNT] = {};
+    uint16_t interval_ = 0;
+    uint16_t latency_ = 0;
+    Counters counters_[PROFILE_COUNT] = {};
+};
+
+}  // namespace conn
@@ -0,0 +1,218 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Entprellen aller Tasten als Bitmaske (Bit i = Taste i+1), Strategie je
+// Taste wählbar. Jede Strategie hat dieselbe Schnittstelle:
+//   update(raw)  neuer Pegel aus dem Interrupt
+//   tick(raw)    Abtast-Tick, solange locked() nicht 0 ist
+// Beide geben die Bits zurück, die sich im entprellten Zustand geändert haben.
+// Den Vergleich auf aufgezeichneten Prellverläufen macht `program bounce`.
+namespace scan {
+
+enum Strategy : uint8_t {
+    DEBOUNCE_EAGER,        // erste Flanke sofort, danach Sperre (schnell, Störimpulse zählen)
+    DEBOUNCE_INTEGRATOR,   // Zähler über die Ticks, übernimmt am Anschlag
+    DEBOUNCE_SHIFT,        // übernimmt nach SAMPLES gleichen Abtastwerten
+    DEBOUNCE_COUNT
+};
+
+// --- EAGER ---
+// Die erste Flanke eines Bits zählt sofort, danach ist das Bit für
+// LOCK_TICKS Abtast-Ticks gesperrt (2-Bit-Vertikalzähler je Bit). Am Ende
+// der Sperre wird gegen den aktuellen Pegel verglichen, damit ein schnelles
+// Loslassen während der Sperre nicht verloren geht.
+class MaskDebouncer {
+public:
+    // Sperre endet nach 2-3 Ticks, je nachdem wo im Tick die Flanke lag
+    static const uint8_t LOCK_TICKS = 3;
+
+    // Neuer Pegel (Interrupt oder Scan): ungesperrte Änderungen übernehmen.
+    // Rückgabe: Bits, die sich im entprellten Zustand geändert haben.
+    uint32_t update(uint32_t raw) {
+        const uint32_t changed = (raw ^ stable_) & ~locked_;
+        stable_ ^= changed;
+        locked_ |= changed;
+        c0_ |= changed;   // Zähler auf 3
+        c1_ |= changed;
+        return changed;
+    }
+
+    // Ein Abtast-Tick: Zähler der gesperrten Bits dekrementieren, bei 0 entsperren
+    uint32_t tick(uint32_t raw) {
+        const uint32_t borrow = ~c0_ & locked_;
+        c0_ ^= locked_;
+        c1_ ^= borrow;
+        locked_ &= c0_ | c1_;
+        return update(raw);
+    }
+
+    // Zustand setzen, z.B. die Weck-Taste nach dem Deep Sleep (gesperrt wie eine neue Flanke)
+    void force(uint32_t stable) {
+        stable_ = stable;
+        locked_ = c0_ = c1_ = stable;
+    }
+
+    void reset() { stable_ = locked_ = c0_ = c1_ = 0; }
+
+    uint32_t stable() const { return stable_; }
+    uint32_t locked() const { return locked_; }
+
+private:
+    uint32_t stable_ = 0;
+    uint32_t locked_ = 0;
+    uint32_t c0_ = 0;
+    uint32_t c1_ = 0;
+};
+
+// --- INTEGRATOR ---
+// Je Bit ein Zähler 0..LEVELS (2-Bit-Vertikalzähler): jeder Tick mit
+// gedrückter Taste zählt hoch, jeder ohne herunter. Gedrückt bei LEVELS,
+// losgelassen bei 0. Einzelne Störimpulse heben sich gegen die Ruhe auf.
+// Interrupts liefern nur den Pegel, übernommen wird erst im Tick.
+class IntegratorDebouncer {
+public:
+    static const uint8_t LEVELS = 3;
+
+    uint32_t update(uint32_t raw) {
+        raw_ = raw;
+        return 0;
+    }
+
+    uint32_t tick(uint32_t raw) {
+        raw_ = raw;
+        const uint32_t up = raw & ~(c1_ & c0_);
+        const uint32_t down = ~raw & (c1_ | c0_);
+        c1_ ^= (c0_ & up) | (~c0_ & down);
+        c0_ ^= up | down;
+        const uint32_t before = stable_;
+        stable_ = (stable_ | (c1_ & c0_)) & (c1_ | c0_);
+        return stable_ ^ before;
+    }
+
+    void force(uint32_t stable) { stable_ = raw_ = c0_ = c1_ = stable; }
+    void reset() { stable_ = raw_ = c0_ = c1_ = 0; }
+
+    uint32_t stable() const { return stable_; }
+    // Pegel weicht ab oder der Zähler steht noch nicht am Anschlag
+    uint32_t locked() const { return (raw_ ^ stable_) | (stable_ & ~(c1_ & c0_)) | (~stable_ & (c1_ | c0_)); }
+
+private:
+    uint32_t stable_ = 0;
+    uint32_t raw_ = 0;
+    uint32_t c0_ = 0;
+    uint32_t c1_ = 0;
+};
+
+// --- SCHIEBEREGISTER ---
+// Die letzten SAMPLES Abtastwerte je Bit; gedrückt, wenn alle gedrückt sind,
+// losgelassen, wenn keiner mehr gedrückt ist. Wie der Integrator nur im Tick.
+class ShiftDebouncer {
+public:
+    static const size_t SAMPLES = 3;
+
+    uint32_t update(uint32_t raw) {
+        raw_ = raw;
+        return 0;
+    }
+
+    uint32_t tick(uint32_t raw) {
+        raw_ = raw;
+        for (size_t i = SAMPLES - 1; i > 0; i--) history_[i] = history_[i - 1];
+        history_[0] = raw;
+        const uint32_t before = stable_;
+        stable_ = (stable_ | allOn()) & anyOn();
+        return stable_ ^ before;
+    }
+
+    void force(uint32_t stable) {
+        stable_ = raw_ = stable;
+        for (uint32_t& h : history_) h = stable;
+    }
+
+    void reset() { force(0); }
+
+    uint32_t stable() const { return stable_; }
+    // Pegel weicht ab oder die Abtastwerte sind noch nicht einig
+    uint32_t locked() const { return (raw_ ^ stable_) | (anyOn() & ~allOn()); }
+
+private:
+    uint32_t allOn() const {
+        uint32_t m = ~0u;
+        for (uint32_t h : history_) m &= h;
+        return m;
+    }
+
+    uint32_t anyOn() const {
+        uint32_t m = 0;
+        for (uint32_t h : history_) m |= h;
+        return m;
+    }
+
+    uint32_t stable_ = 0;
+    uint32_t raw_ = 0;
+    uint32_t history_[SAMPLES] = {};
+};
+
+// --- JE TASTE ---
+// Alle drei Strategien laufen auf der ganzen Maske mit, jede Taste nimmt das
+// Ergebnis ihrer Strategie. Standard: DEBOUNCE_EAGER für alle.
+class Debouncer {
+public:
+    // strategies[i] für Taste i+1, weitere Tasten bleiben EAGER. Der
+    // entprellte Zustand bleibt dabei erhalten.
+    void setStrategies(const uint8_t* strategies, size_t count) {
+        const uint32_t current = stable();
+        integratorBits_ = shiftBits_ = 0;
+        for (size_t i = 0; i < count && i < 32; i++) {
+            if (strategies[i] == DEBOUNCE_INTEGRATOR) integratorBits_ |= 1u << i;
+            else if (strategies[i] == DEBOUNCE_SHIFT) shiftBits_ |= 1u << i;
+        }
+        eagerBits_ = ~(integratorBits_ | shiftBits_);
+        force(current);
+    }
+
+    uint32_t update(uint32_t raw) {
+        return (eager_.update(raw) & eagerBits_) | (integrator_.update(raw) & integratorBits_) |
+               (shift_.update(raw) & shiftBits_);
+    }
+
+    uint32_t tick(uint32_t raw) {
+        return (eager_.tick(raw) & eagerBits_) | (integrator_.tick(raw) & integratorBits_) |
+               (shift_.tick(raw) & shiftBits_);
+    }
+
+    void force(uint32_t stable) {
+        eager_.force(stable);
+        integrator_.force(stable);
+        shift_.force(stable);
+    }
+
+    void reset() {
+        eager_.reset();
+        integrator_.reset();
+        shift_.reset();
+    }
+
+    uint32_t stable() const {
+        return (eager_.stable() & eagerBits_) | (integrator_.stable() & integratorBits_) | (shift_.stable() & shiftBits_);
+    }
+
+    // Bits, für die noch Abtast-Ticks nötig sind
+    uint32_t locked() const {
+        return (eager_.locked() & eagerBits_) | (integrator_.locked() & integratorBits_) | (shift_.locked() & shiftBits_);
+    }
+
+    // Bits, deren Druck erst ein Tick bestätigt (nicht schon der Interrupt)
+    uint32_t sampled() const { return integratorBits_ | shiftBits_; }
+
+private:
+    MaskDebouncer eager_;
+    IntegratorDebouncer integrator_;
+    ShiftDebouncer shift_;
+    uint32_t eagerBits_ = ~0u;
+    uint32_t integratorBits_ = 0;
+    uint32_t shiftBits_ = 0;
+};
+
+}  // namespace scan
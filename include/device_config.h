@@ -0,0 +1,246 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "adv_scheduler.h"
+#include "gesture_engine.h"
+#include "hid_macro.h"
+#include "remote_config.h"
+
+// Laufzeit-Einstellungen aus einem kompakten TLV-Blob. Der Host schreibt den
+// Blob auf die Konfigurations-Characteristic; er wird erst vollständig geprüft,
+// dann als ein Eintrag im NVS gespeichert und beim Start mit einem einzigen
+// Lesezugriff geladen. Nicht enthaltene Felder behalten ihren Standardwert
+// (remote_config.h); ein neuer Blob ersetzt den alten also vollständig.
+//
+// Aufbau: [CONFIG_VERSION] dann beliebig viele [Typ][Länge][Wert], little endian.
+// Unbekannte Typen werden übersprungen (ältere Firmware, neuerer Host).
+namespace cfg {
+
+const uint8_t CONFIG_VERSION = 1;
+const size_t MAX_BLOB = 256;
+const size_t MAX_NAME = 20;
+const size_t MAX_BUTTONS = 8;
+const size_t MAX_MACROS = 8;
+const size_t MACRO_POOL = 160;   // Texte aller Makros inkl. Nullbytes
+
+enum Type : uint8_t {
+    T_DEBOUNCE_MS = 1,      // u16, 4-200
+    T_BATTERY_INTERVAL,     // u32 ms, 1000-600000
+    T_LED_BLINK_MS,         // u16, 0 = LED-Feedback aus, sonst 10-1000
+    T_SLEEP_TIMEOUT,        // u32 ms, 0 = nie, sonst ab 30000
+    T_TX_POWER,             // i8 dBm, -12 bis 9 in 3er-Schritten (wirkt sofort)
+    T_NAME,                 // 1-20 Zeichen ASCII (wirkt nach Neustart)
+    T_GESTURE,              // u8 Taste (1-8), u8 gesture::MapBits ohne MAP_CHORD
+    T_CHORD,                // u8 0/1
+    T_MACRO,                // u8 Code, dann Makro-Text (hid_macro.h); ersetzt HID_MACROS
+    T_ADV_PHASE,            // u16 Intervall x0.625 ms, u16 Dauer s; je Phase ein Eintrag,
+                            // in Reihenfolge, ersetzt ADV_PHASES (Regeln: adv::valid())
+    T_DEBOUNCE_STRATEGY,    // u8 Taste (1-8), u8 scan::Strategy
+    T_REPEAT,               // u16 Verzögerung 100-2000 ms (auch langer Druck), u16 Start-Abstand
+                            // 20-1000 ms, u16 kleinster Abstand 20 bis Start, u16 Rampe 0-10000 ms
+};
+
+enum Error : uint8_t {
+    OK,
+    ERR_VERSION,
+    ERR_TRUNCATED,    // TLV ragt über das Ende
+    ERR_LENGTH,       // Länge passt nicht zum Typ
+    ERR_RANGE,        // Wert außerhalb des erlaubten Bereichs
+    ERR_TOO_MANY,     // zu viele Makros / Makro-Text zu lang
+    ERR_MACRO,        // Makro lässt sich nicht übersetzen
+    ERR_STORAGE,      // NVS-Schreiben fehlgeschlagen
+    ERR_BUSY,         // vorheriger Blob noch nicht verarbeitet
+};
+
+struct Settings {
+    uint16_t debounceMs;
+    uint32_t batteryIntervalMs;
+    uint16_t ledBlinkMs;
+    uint32_t sleepTimeoutMs;
+    int8_t txPowerDbm;
+    char name[MAX_NAME + 1];
+    uint8_t gestureMaps[MAX_BUTTONS];
+    uint8_t debounceStrategies[MAX_BUTTONS];   // scan::Strategy je Taste
+    gesture::Timing gestureTiming;
+    bool chord;
+    // Makros aus dem Blob: Codes und nullterminierte Texte hintereinander in
+    // macroText (keine Zeiger, Settings darf kopiert werden); 0 = HID_MACROS
+    uint8_t macroCodes[MAX_MACROS];
+    size_t macroCount;
+    char macroText[MACRO_POOL];
+    adv::Phase advPhases[adv::MAX_PHASES];
+    size_t advPhaseCount;
+};
+
+static_assert(sizeof(ADV_PHASES) / sizeof(ADV_PHASES[0]) <= adv::MAX_PHASES, "zu viele Advertising-Phasen");
+static_assert(sizeof(DEBOUNCE_STRATEGIES) / sizeof(DEBOUNCE_STRATEGIES[0]) <= MAX_BUTTONS, "zu viele Entprell-Strategien");
+
+inline Settings defaults() {
+    Settings s = {};
+    s.debounceMs = DEBOUNCE_MS;
+    s.batteryIntervalMs = BATTERY_INTERVAL;
+    s.ledBlinkMs = LED_BLINK_MS;
+    s.sleepTimeoutMs = SLEEP_TIMEOUT;
+    s.txPowerDbm = TX_POWER_DBM;
+    strncpy(s.name, DEVICE_NAME, MAX_NAME);
+    s.gestureMaps[0] = GESTURES_NEXT;
+    s.gestureMaps[1] = GESTURES_PREV;
+    for (size_t i = 0; i < sizeof(DEBOUNCE_STRATEGIES) / sizeof(DEBOUNCE_STRATEGIES[0]); i++)
+        s.debounceStrategies[i] = DEBOUNCE_STRATEGIES[i];
+    s.chord = GESTURE_CHORD;
+    s.gestureTiming = gesture::DEFAULT_TIMING;
+    s.gestureTiming.longMs = REPEAT_DELAY_MS;
+    s.gestureTiming.repeatMs = REPEAT_START_MS;
+    s.gestureTiming.repeatMinMs = REPEAT_MIN_MS;
+    s.gestureTiming.repeatRampMs = REPEAT_RAMP_MS;
+    for (const adv::Phase& p : ADV_PHASES) s.advPhases[s.advPhaseCount++] = p;
+    return s;
+}
+
+// Makros als hid::MacroSource für MacroTable::build(), Zeiger zeigen in s
+inline size_t macroSources(const Settings& s, hid::MacroSource* out) {
+    const char* text = s.macroText;
+    for (size_t i = 0; i < s.macroCount; i++) {
+        out[i] = {s.macroCodes[i], text};
+        text += strlen(text) + 1;
+    }
+    return s.macroCount;
+}
+
+inline uint16_t getU16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+inline uint32_t getU32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Feste Länge je Typ, 0 = variabel
+inline size_t fixedLength(uint8_t type) {
+    switch (type) {
+    case T_DEBOUNCE_MS: return 2;
+    case T_BATTERY_INTERVAL: return 4;
+    case T_LED_BLINK_MS: return 2;
+    case T_SLEEP_TIMEOUT: return 4;
+    case T_TX_POWER: return 1;
+    case T_GESTURE: return 2;
+    case T_CHORD: return 1;
+    case T_ADV_PHASE: return 4;
+    case T_DEBOUNCE_STRATEGY: return 2;
+    case T_REPEAT: return 8;
+    default: return 0;
+    }
+}
+
+// Prüft den ganzen Blob und übernimmt ihn erst dann in out (ausgehend von
+// den Werten, die out schon hat, normalerweise defaults()). Bei einem Fehler
+// bleibt out unverändert. Ob sich die Makro-Texte übersetzen lassen, prüft
+// erst MacroTable::build().
+inline Error parse(const uint8_t* blob, size_t len, Settings& out) {
+    if (len < 1 || len > MAX_BLOB || blob[0] != CONFIG_VERSION) return ERR_VERSION;
+    Settings s = out;
+    size_t textUsed = 0;
+    bool macrosSeen = false;
+    bool advSeen = false;
+    size_t pos = 1;
+    while (pos < len) {
+        if (pos + 2 > len) return ERR_TRUNCATED;
+        const uint8_t type = blob[pos];
+        const uint8_t n = blob[pos + 1];
+        const uint8_t* v = blob + pos + 2;
+        if (pos + 2 + n > len) return ERR_TRUNCATED;
+        pos += 2 + n;
+        const size_t fixed = fixedLength(type);
+        if (fixed && n != fixed) return ERR_LENGTH;
+
+        switch (type) {
+        case T_DEBOUNCE_MS:
+            s.debounceMs = getU16(v);
+            if (s.debounceMs < 4 || s.debounceMs > 200) return ERR_RANGE;
+            break;
+        case T_BATTERY_INTERVAL:
+            s.batteryIntervalMs = getU32(v);
+            if (s.batteryIntervalMs < 1000 || s.batteryIntervalMs > 600000) return ERR_RANGE;
+            break;
+        case T_LED_BLINK_MS:
+            s.ledBlinkMs = getU16(v);
+            if (s.ledBlinkMs != 0 && (s.ledBlinkMs < 10 || s.ledBlinkMs > 1000)) return ERR_RANGE;
+            break;
+        case T_SLEEP_TIMEOUT:
+            s.sleepTimeoutMs = getU32(v);
+            if (s.sleepTimeoutMs != 0 && s.sleepTimeoutMs < 30000) return ERR_RANGE;
+            break;
+        case T_TX_POWER:
+            s.txPowerDbm = (int8_t)v[0];
+            if (s.txPowerDbm < -12 || s.txPowerDbm > 9 || (s.txPowerDbm + 12) % 3 != 0) return ERR_RANGE;
+            break;
+        case T_NAME:
+            if (n < 1 || n > MAX_NAME) return ERR_LENGTH;
+            for (size_t i = 0; i < n; i++)
+                if (v[i] < 0x20 || v[i] > 0x7E) return ERR_RANGE;
+            memcpy(s.name, v, n);
+            s.name[n] = '\0';
+            break;
+        case T_GESTURE:
+            if (v[0] < 1 || v[0] > MAX_BUTTONS || v[1] >= gesture::MAP_CHORD) return ERR_RANGE;
+            s.gestureMaps[v[0] - 1] = v[1];
+            break;
+        case T_CHORD:
+            if (v[0] > 1) return ERR_RANGE;
+            s.chord = v[0];
+            break;
+        case T_MACRO:
+            if (n < 2) return ERR_LENGTH;
+            // Erstes Makro im Blob ersetzt alle bisherigen
+            if (!macrosSeen) s.macroCount = 0;
+            macrosSeen = true;
+            if (s.macroCount == MAX_MACROS || textUsed + n > MACRO_POOL) return ERR_TOO_MANY;
+            for (size_t i = 1; i < n; i++)
+                if (v[i] < 0x20 || v[i] > 0x7E) return ERR_RANGE;
+            memcpy(s.macroText + textUsed, v + 1, n - 1);
+            s.macroText[textUsed + n - 1] = '\0';
+            s.macroCodes[s.macroCount++] = v[0];
+            textUsed += n;
+            break;
+        case T_ADV_PHASE:
+            // Erste Phase im Blob ersetzt die ganze Folge
+            if (!advSeen) s.advPhaseCount = 0;
+            advSeen = true;
+            if (s.advPhaseCount == adv::MAX_PHASES) return ERR_TOO_MANY;
+            s.advPhases[s.advPhaseCount++] = {getU16(v), getU16(v + 2)};
+            break;
+        case T_DEBOUNCE_STRATEGY:
+            if (v[0] < 1 || v[0] > MAX_BUTTONS || v[1] >= scan::DEBOUNCE_COUNT) return ERR_RANGE;
+            s.debounceStrategies[v[0] - 1] = v[1];
+            break;
+        case T_REPEAT: {
+            const uint16_t delay = getU16(v), start = getU16(v + 2), min = getU16(v + 4), ramp = getU16(v + 6);
+            if (delay < 100 || delay > 2000 || start < 20 || start > 1000 || min < 20 || min > start || ramp > 10000)
+                return ERR_RANGE;
+            s.gestureTiming.longMs = delay;
+            s.gestureTiming.repeatMs = start;
+            s.gestureTiming.repeatMinMs = min;
+            s.gestureTiming.repeatRampMs = ramp;
+            break;
+        }
+        default:
+            break;
+        }
+    }
+    if (!adv::valid(s.advPhases, s.advPhaseCount)) return ERR_RANGE;
+    out = s;
+    return OK;
+}
+
+// Einen Eintrag an einen Blob anhängen (Host-Seite, Simulator). false, wenn kein Platz.
+inline bool put(uint8_t* blob, size_t& len, size_t cap, uint8_t type, const void* value, uint8_t n) {
+    if (len + 2 + n > cap) return false;
+    blob[len++] = type;
+    blob[len++] = n;
+    memcpy(blob + len, value, n);
+    len += n;
+    return true;
+}
+
+}  // namespace cfg
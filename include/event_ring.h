@@ -0,0 +1,67 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Lock-freier Ringpuffer für genau einen Producer und einen Consumer.
+// Producer ist z.B. eine ISR, Consumer die loop(). N muss eine Zweierpotenz
+// sein, damit der Index mit einer Maske statt Modulo berechnet wird.
+// push() läuft in ISRs, die auf dem ESP32 im IRAM liegen -> erzwungen inline,
+// damit kein Aufruf in den Flash (Cache evtl. aus) entsteht.
+#define EVENT_RING_INLINE inline __attribute__((always_inline))
+
+template <typename T, size_t N>
+class EventRing {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "N muss eine Zweierpotenz sein");
+
+public:
+    // Nur vom Producer aufrufen. Gibt false zurück, wenn der Puffer voll ist.
+    EVENT_RING_INLINE bool push(const T& item) {
+        const uint32_t head = head_.load(std::memory_order_relaxed);
+        const uint32_t tail = tail_.load(std::memory_order_acquire);
+        if (head - tail >= N) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        buffer_[head & (N - 1)] = item;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Nur vom Consumer aufrufen. Gibt false zurück, wenn nichts ansteht.
+    bool pop(T& item) {
+        const uint32_t tail = tail_.load(std::memory_order_relaxed);
+        const uint32_t head = head_.load(std::memory_order_acquire);
+        if (head == tail) return false;
+        item = buffer_[tail & (N - 1)];
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Nur vom Consumer aufrufen: ältestes Event lesen, ohne es zu entnehmen
+    bool peek(T& item) const {
+        const uint32_t tail = tail_.load(std::memory_order_relaxed);
+        if (head_.load(std::memory_order_acquire) == tail) return false;
+        item = buffer_[tail & (N - 1)];
+        return true;
+    }
+
+    bool empty() const {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+
+    size_t size() const {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+
+    static constexpr size_t capacity() { return N; }
+
+    // Anzahl Events, die wegen vollem Puffer verworfen wurden
+    uint32_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    T buffer_[N];
+    std::atomic<uint32_t> head_{0};
+    std::atomic<uint32_t> tail_{0};
+    std::atomic<uint32_t> dropped_{0};
+};
@@ -0,0 +1,234 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Ereignis-Log im Flash: Ringpuffer aus Sektoren, nur anhängen.
+// Jeder Sektor beginnt mit einem Kopf (Magic, laufende Nummer), danach folgen
+// Datensätze fester Größe mit CRC. Ist der aktuelle Sektor voll, wird der
+// nächste im Ring gelöscht und übernommen -> alle Sektoren verschleißen gleich.
+//
+// Datensätze sammeln sich zuerst in einem RAM-Puffer und gehen gebündelt in
+// den Flash. Nach einem Stromausfall mitten im Schreiben findet mount() den
+// letzten Sektor über die höchste Nummer; halb geschriebene Datensätze fallen
+// über die CRC heraus, geschrieben wird hinter dem letzten benutzten Platz.
+//
+// Flash-Schnittstelle (Template-Parameter, Instanz):
+//   size_t sectorSize() const, size_t sectorCount() const
+//   bool read(uint32_t addr, void* buf, size_t len)
+//   bool write(uint32_t addr, const void* data, size_t len)   // nur 1 -> 0
+//   bool erase(uint32_t sector)                              // alles auf 0xFF
+namespace flashlog {
+
+enum Event : uint8_t {
+    EV_BOOT = 1,        // arg: Weck-Taste (0 = normaler Start)
+    EV_PRESS,           // arg: Code
+    EV_CONNECT,
+    EV_DISCONNECT,
+    EV_DEEP_SLEEP,
+    EV_MODE,            // arg: neuer Modus
+    EV_REPLAY_DROPPED,  // arg: verworfene Drücke (zu alt / Puffer voll)
+    EV_OTA,             // arg: ota::Status (Start, Abschluss, Fehler)
+};
+
+enum ConnState : uint8_t {
+    CONN_NONE,
+    CONN_CONNECTED,
+    CONN_READY,   // Host hört zu
+};
+
+// 12 Bytes im Flash, little endian wie auf dem ESP32
+struct Record {
+    uint32_t timeMs;    // hal::rtcMillis()
+    uint8_t event;
+    uint8_t arg;
+    uint8_t battery;    // %
+    uint8_t conn;       // ConnState
+    int8_t rssi;        // dBm, 0 = unbekannt
+    uint8_t reserved;
+    uint16_t crc;
+};
+static_assert(sizeof(Record) == 12, "Datensatz-Layout");
+
+const uint32_t SECTOR_MAGIC = 0x474F4C45;   // "ELOG"
+const size_t SLOT_SIZE = sizeof(Record);
+
+// CRC-16/CCITT-FALSE
+inline uint16_t crc16(const uint8_t* data, size_t len, uint16_t crc = 0xFFFF) {
+    for (size_t i = 0; i < len; i++) {
+        crc ^= (uint16_t)(data[i] << 8);
+        for (int b = 0; b < 8; b++) crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+    return crc;
+}
+
+inline void seal(Record& r) {
+    r.crc = crc16((const uint8_t*)&r, offsetof(Record, crc));
+}
+
+inline bool valid(const Record& r) {
+    return r.crc == crc16((const uint8_t*)&r, offsetof(Record, crc));
+}
+
+inline bool erased(const void* p, size_t len) {
+    const uint8_t* b = (const uint8_t*)p;
+    for (size_t i = 0; i < len; i++)
+        if (b[i] != 0xFF) return false;
+    return true;
+}
+
+// Sektorkopf belegt den ersten Platz
+struct SectorHeader {
+    uint32_t magic;
+    uint32_t seq;
+    uint16_t reserved;
+    uint16_t crc;
+};
+static_assert(sizeof(SectorHeader) == SLOT_SIZE, "Kopf belegt genau einen Platz");
+
+template <class Flash, size_t STAGE>
+class Log {
+public:
+    struct Cursor {
+        uint32_t sector;
+        uint32_t slot;
+        uint32_t sectorsLeft;
+    };
+
+    explicit Log(Flash& flash) : flash_(flash) {}
+
+    // Letzten Sektor suchen bzw. leeren Flash formatieren. false ohne Flash.
+    bool mount() {
+        staged_ = 0;
+        ready_ = false;
+        if (flash_.sectorCount() < 2) return false;
+        slotsPerSector_ = (uint32_t)(flash_.sectorSize() / SLOT_SIZE);
+
+        bool found = false;
+        for (uint32_t s = 0; s < flash_.sectorCount(); s++) {
+            uint32_t seq;
+            if (!readHeader(s, seq)) continue;
+            if (!found || (int32_t)(seq - headSeq_) > 0) {
+                head_ = s;
+                headSeq_ = seq;
+                found = true;
+            }
+        }
+        if (!found) return ready_ = openSector(0, 1);
+
+        // Schreibposition: hinter dem letzten nicht gelöschten Platz
+        writeSlot_ = 1;
+        Record r;
+        for (uint32_t slot = slotsPerSector_ - 1; slot >= 1; slot--) {
+            if (!flash_.read(addr(head_, slot), &r, SLOT_SIZE)) return false;
+            if (!erased(&r, SLOT_SIZE)) {
+                writeSlot_ = slot + 1;
+                break;
+            }
+        }
+        return ready_ = true;
+    }
+
+    // Alles löschen und neu beginnen
+    bool format() {
+        staged_ = 0;
+        ready_ = false;
+        if (flash_.sectorCount() < 2) return false;
+        slotsPerSector_ = (uint32_t)(flash_.sectorSize() / SLOT_SIZE);
+        for (uint32_t s = 0; s < flash_.sectorCount(); s++)
+            if (!flash_.erase(s)) return false;
+        return ready_ = openSector(0, headSeq_ + 1);
+    }
+
+    // In den RAM-Puffer; ist er voll, geht er gesammelt in den Flash
+    void append(Record r) {
+        if (!ready_) return;
+        seal(r);
+        stage_[staged_++] = r;
+        if (staged_ == STAGE) flush();
+    }
+
+    // Schlägt ein Flash-Zugriff fehl, ist die Schreibposition ungewiss ->
+    // Log bis zum nächsten mount() aus, der Puffer ist verloren
+    bool flush() {
+        if (!ready_) return false;
+        size_t done = 0;
+        while (done < staged_) {
+            if (writeSlot_ >= slotsPerSector_ && !openSector((head_ + 1) % flash_.sectorCount(), headSeq_ + 1)) break;
+            // So viele Datensätze am Stück, wie in den Sektor passen
+            const size_t n = std::min(staged_ - done, (size_t)(slotsPerSector_ - writeSlot_));
+            if (!flash_.write(addr(head_, writeSlot_), &stage_[done], n * SLOT_SIZE)) break;
+            writeSlot_ += (uint32_t)n;
+            done += n;
+        }
+        ready_ = done == staged_;
+        staged_ = 0;
+        return ready_;
+    }
+
+    size_t pending() const { return staged_; }
+    bool ready() const { return ready_; }
+
+    // Ältester Sektor zuerst: der Ring läuft ab dem Sektor hinter head_
+    Cursor begin() const {
+        return {(head_ + 1) % (uint32_t)flash_.sectorCount(), 1, (uint32_t)flash_.sectorCount()};
+    }
+
+    // Nächster gültiger Datensatz im Flash (ohne RAM-Puffer), false am Ende
+    bool next(Cursor& c, Record& out) {
+        while (ready_ && c.sectorsLeft > 0) {
+            uint32_t seq;
+            const bool isHead = c.sector == head_;
+            const uint32_t end = isHead ? writeSlot_ : slotsPerSector_;
+            if (c.slot == 1 && !readHeader(c.sector, seq)) c.slot = end;   // unbenutzter Sektor
+            while (c.slot < end) {
+                if (!flash_.read(addr(c.sector, c.slot++), &out, SLOT_SIZE)) return false;
+                if (valid(out) && !erased(&out, SLOT_SIZE)) return true;
+            }
+            c.sector = (c.sector + 1) % (uint32_t)flash_.sectorCount();
+            c.slot = 1;
+            c.sectorsLeft--;
+        }
+        return false;
+    }
+
+    // Platz im Flash in Datensätzen (ohne Köpfe)
+    size_t capacity() const { return (size_t)(slotsPerSector_ - 1) * flash_.sectorCount(); }
+
+private:
+    uint32_t addr(uint32_t sector, uint32_t slot) const {
+        return (uint32_t)(sector * flash_.sectorSize() + slot * SLOT_SIZE);
+    }
+
+    bool readHeader(uint32_t sector, uint32_t& seq) {
+        SectorHeader h;
+        if (!flash_.read(addr(sector, 0), &h, SLOT_SIZE)) return false;
+        if (h.magic != SECTOR_MAGIC || h.crc != crc16((const uint8_t*)&h, offsetof(SectorHeader, crc))) return false;
+        seq = h.seq;
+        return true;
+    }
+
+    // Sektor löschen und als neuen Kopf markieren
+    bool openSector(uint32_t sector, uint32_t seq) {
+        if (!flash_.erase(sector)) return false;
+        SectorHeader h = {SECTOR_MAGIC, seq, 0xFFFF, 0};
+        h.crc = crc16((const uint8_t*)&h, offsetof(SectorHeader, crc));
+        if (!flash_.write(addr(sector, 0), &h, SLOT_SIZE)) return false;
+        head_ = sector;
+        headSeq_ = seq;
+        writeSlot_ = 1;
+        return true;
+    }
+
+    Flash& flash_;
+    Record stage_[STAGE];
+    size_t staged_ = 0;
+    bool ready_ = false;
+    uint32_t slotsPerSector_ = 0;
+    uint32_t head_ = 0;
+    uint32_t headSeq_ = 0;
+    uint32_t writeSlot_ = 1;
+};
+
+}  // namespace flashlog
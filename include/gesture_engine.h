@@ -0,0 +1,325 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Gesten-Erkennung über entprellten Flanken: Klick, langer Druck, Doppelklick,
+// Dauerfeuer beim Halten (mit Beschleunigung) und Akkord (zwei Tasten gleichzeitig).
+// Jede Taste hat einen eigenen Automaten; die Übergänge stehen je Belegung in
+// einer constexpr-Tabelle, zur Laufzeit wird nur nachgeschlagen (kein Heap).
+//
+// Auf eine Geste wird nur gewartet, wenn sie belegt ist: ohne Doppelklick und
+// langen Druck geht der Klick wie bisher sofort beim Drücken raus.
+namespace gesture {
+
+// Codes in den Tasten-Paketen: unteres Nibble Taste, oberes Nibble Geste.
+// Ein Klick ist damit weiterhin die nackte ButtonId (kompatibel zur Bridge).
+enum Gesture : uint8_t {
+    GESTURE_CLICK = 0x00,
+    GESTURE_LONG = 0x10,
+    GESTURE_DOUBLE = 0x20,
+    GESTURE_REPEAT = 0x30,
+    GESTURE_CHORD = 0x40,  // unteres Nibble: Bitmaske der Tasten 1-4
+};
+
+// Grenzen des Formats: Taste im unteren Nibble (0 bleibt frei), Akkorde als
+// Bitmaske in denselben 4 Bit. Mehr Tasten brauchen ein breiteres Paketformat
+// (Firmware und bridge_app.py gemeinsam).
+constexpr size_t MAX_BUTTON = 15;
+constexpr size_t MAX_CHORD_BUTTON = 4;
+
+constexpr uint8_t code(uint8_t button, Gesture g) {
+    return (uint8_t)(g | (button & 0x0F));
+}
+
+constexpr uint8_t chordCode(uint8_t a, uint8_t b) {
+    return (uint8_t)(GESTURE_CHORD | (1u << (a - 1)) | (1u << (b - 1)));
+}
+
+// Belegung je Taste (Bitmaske); MAP_CHORD gilt für alle Tasten gemeinsam
+enum MapBits : uint8_t {
+    MAP_LONG = 1 << 0,
+    MAP_DOUBLE = 1 << 1,
+    MAP_REPEAT = 1 << 2,
+    MAP_CHORD = 1 << 3,
+    MAP_COUNT = 1 << 4
+};
+
+// Dauerfeuer: Abstand erst repeatMs, dann steigt die Rate über repeatRampMs
+// linear bis 1/repeatMinMs. Ohne Rampe (0) oder repeatMinMs >= repeatMs
+// bleibt der Abstand fest.
+struct Timing {
+    uint16_t chordMs;       // zweite Taste innerhalb dieser Zeit -> Akkord
+    uint16_t longMs;        // Haltezeit bis langer Druck / erstes Dauerfeuer
+    uint16_t doubleMs;      // Pause nach dem Loslassen, in der ein zweiter Druck zählt
+    uint16_t repeatMs;      // Abstand beim Dauerfeuer (Start der Rampe)
+    uint16_t repeatMinMs;   // kleinster Abstand am Ende der Rampe
+    uint16_t repeatRampMs;  // Dauer der Rampe ab dem ersten Dauerfeuer
+};
+
+constexpr Timing DEFAULT_TIMING = {40, 500, 250, 150, 150, 0};
+
+// Schneller als so oft wird nicht gemeldet: fällige Wiederholungen gehen
+// gesammelt als ein Code mit Anzahl raus (ein Eintrag im Tasten-Paket)
+const uint16_t REPEAT_BATCH_MS = 50;
+
+// Wiederholungen nach elapsedMs ab dem ersten Dauerfeuer, das erste
+// mitgezählt: Integral der Rate, in tausendstel Wiederholungen gerechnet
+constexpr uint32_t repeatsDue(const Timing& t, uint32_t elapsedMs) {
+    const uint64_t S = 1000;
+    const uint64_t i0 = t.repeatMs ? t.repeatMs : 1;
+    const uint64_t i1 = t.repeatMinMs && t.repeatMinMs < i0 ? t.repeatMinMs : i0;
+    const uint64_t ramp = i1 < i0 ? t.repeatRampMs : 0;
+    const uint64_t r = elapsedMs < ramp ? elapsedMs : ramp;
+    const uint64_t inRamp = ramp ? r * S / i0 + S * (i0 - i1) * r * r / (2 * ramp * i0 * i1) : 0;
+    return (uint32_t)((inRamp + (elapsedMs - r) * S / i1) / S + 1);
+}
+
+// Aktueller Abstand nach elapsedMs (Kehrwert der Rate)
+constexpr uint32_t repeatIntervalAt(const Timing& t, uint32_t elapsedMs) {
+    const uint64_t i0 = t.repeatMs ? t.repeatMs : 1;
+    const uint64_t i1 = t.repeatMinMs && t.repeatMinMs < i0 ? t.repeatMinMs : i0;
+    const uint64_t ramp = i1 < i0 ? t.repeatRampMs : 0;
+    if (elapsedMs >= ramp) return (uint32_t)i1;
+    return (uint32_t)(i0 * i1 * ramp / (i1 * ramp + (i0 - i1) * elapsedMs));
+}
+
+static_assert(repeatsDue(DEFAULT_TIMING, 0) == 1 && repeatsDue(DEFAULT_TIMING, 1499) == 10, "ohne Rampe fester Abstand");
+static_assert(repeatsDue({0, 0, 0, 100, 20, 1000}, 1000) == 31, "Rampe: Mittel aus 10/s und 50/s über 1 s");
+
+// --- AUTOMAT ---
+enum State : uint8_t {
+    ST_IDLE,
+    ST_CHORD_WAIT,  // gedrückt, Akkord-Fenster läuft noch
+    ST_DOWN,        // gedrückt, noch nichts gemeldet (oder Klick schon beim Drücken)
+    ST_HELD,        // langer Druck erkannt, ggf. Dauerfeuer
+    ST_UP_WAIT,     // losgelassen, wartet auf zweiten Druck
+    ST_DOWN2,       // Doppelklick gemeldet, wartet aufs Loslassen
+    ST_CHORD,       // Teil eines Akkords, alles bis zum Loslassen verschlucken
+    STATE_COUNT
+};
+
+enum Input : uint8_t { IN_PRESS, IN_RELEASE, IN_TIMEOUT, INPUT_COUNT };
+
+enum Emit : uint8_t { EMIT_NONE, EMIT_CLICK, EMIT_LONG, EMIT_DOUBLE, EMIT_REPEAT };
+
+enum TimerCmd : uint8_t { TIMER_KEEP, TIMER_STOP, TIMER_CHORD, TIMER_LONG, TIMER_DOUBLE, TIMER_REPEAT };
+
+struct Transition {
+    State next;
+    Emit emit;
+    TimerCmd timer;
+};
+
+constexpr Transition transitionFor(uint8_t map, State s, Input in) {
+    const bool hasLong = map & MAP_LONG;
+    const bool hasDouble = map & MAP_DOUBLE;
+    const bool hasRepeat = map & MAP_REPEAT;
+    const bool hasChord = map & MAP_CHORD;
+    // Klick gleich beim Drücken, wenn keine andere Deutung mehr möglich ist
+    const bool clickOnPress = !hasLong && !hasDouble;
+    const TimerCmd holdTimer = (hasLong || hasRepeat) ? TIMER_LONG : TIMER_STOP;
+
+    switch (s) {
+    case ST_IDLE:
+        if (in != IN_PRESS) break;
+        if (hasChord) return {ST_CHORD_WAIT, EMIT_NONE, TIMER_CHORD};
+        return {ST_DOWN, clickOnPress ? EMIT_CLICK : EMIT_NONE, holdTimer};
+    case ST_CHORD_WAIT:
+        // Akkord-Fenster vorbei: weiter wie ohne Akkord-Belegung
+        if (in == IN_TIMEOUT) return {ST_DOWN, clickOnPress ? EMIT_CLICK : EMIT_NONE, holdTimer};
+        if (in == IN_RELEASE) {
+            if (hasDouble) return {ST_UP_WAIT, EMIT_NONE, TIMER_DOUBLE};
+            return {ST_IDLE, EMIT_CLICK, TIMER_STOP};
+        }
+        break;
+    case ST_DOWN:
+        if (in == IN_RELEASE) {
+            if (hasDouble) return {ST_UP_WAIT, EMIT_NONE, TIMER_DOUBLE};
+            return {ST_IDLE, clickOnPress ? EMIT_NONE : EMIT_CLICK, TIMER_STOP};
+        }
+        if (in == IN_TIMEOUT) {
+            if (hasLong) return {ST_HELD, EMIT_LONG, hasRepeat ? TIMER_REPEAT : TIMER_STOP};
+            if (hasRepeat) return {ST_HELD, EMIT_REPEAT, TIMER_REPEAT};
+        }
+        break;
+    case ST_HELD:
+        if (in == IN_RELEASE) return {ST_IDLE, EMIT_NONE, TIMER_STOP};
+        if (in == IN_TIMEOUT && hasRepeat) return {ST_HELD, EMIT_REPEAT, TIMER_REPEAT};
+        break;
+    case ST_UP_WAIT:
+        if (in == IN_PRESS) return {ST_DOWN2, EMIT_DOUBLE, TIMER_STOP};
+        if (in == IN_TIMEOUT) return {ST_IDLE, EMIT_CLICK, TIMER_STOP};
+        break;
+    case ST_DOWN2:
+    case ST_CHORD:
+        if (in == IN_RELEASE) return {ST_IDLE, EMIT_NONE, TIMER_STOP};
+        break;
+    default:
+        break;
+    }
+    return {s, EMIT_NONE, TIMER_KEEP};
+}
+
+struct Table {
+    Transition t[MAP_COUNT][STATE_COUNT][INPUT_COUNT];
+
+    constexpr Table() : t() {
+        for (uint8_t m = 0; m < MAP_COUNT; m++)
+            for (uint8_t s = 0; s < STATE_COUNT; s++)
+                for (uint8_t i = 0; i < INPUT_COUNT; i++) t[m][s][i] = transitionFor(m, (State)s, (Input)i);
+    }
+};
+
+constexpr Table TABLE{};
+
+static_assert(TABLE.t[0][ST_IDLE][IN_PRESS].emit == EMIT_CLICK, "ohne Belegung: Klick ohne Wartezeit");
+static_assert(TABLE.t[MAP_REPEAT][ST_IDLE][IN_PRESS].emit == EMIT_CLICK, "Dauerfeuer verzögert den Klick nicht");
+static_assert(TABLE.t[MAP_DOUBLE][ST_DOWN][IN_RELEASE].timer == TIMER_DOUBLE, "Doppelklick wartet nach dem Loslassen");
+
+// --- ENGINE ---
+// Tasten 1..N (ButtonId). Ausgaben gehen über emit(code, count, edgeUs, ctx):
+// count ist nur beim Dauerfeuer größer als 1 (gesammelte Wiederholungen),
+// edgeUs die Flanke des Drucks, zu dem die Geste gehört (für die Latenzmessung).
+// Die Engine merkt sich nur Fristen; der Aufrufer ruft poll() nach timeUntilNext().
+template <size_t N>
+class Engine {
+    static_assert(N >= 1 && N <= MAX_BUTTON, "Tastennummer passt nicht ins untere Nibble des Codes");
+
+public:
+    typedef void (*EmitFn)(uint8_t code, uint8_t count, uint32_t edgeUs, void* ctx);
+
+    static const uint32_t NO_DEADLINE = 0xFFFFFFFF;
+
+    Engine(EmitFn emit, void* ctx = nullptr) : emit_(emit), ctx_(ctx) {}
+
+    void setTiming(const Timing& t) { timing_ = t; }
+
+    void setMap(uint8_t button, uint8_t map) {
+        if (button < 1 || button > N) return;
+        map_[button - 1] = map & (MAP_LONG | MAP_DOUBLE | MAP_REPEAT);
+    }
+
+    // Ab der 5. Taste ist im Code kein Bit mehr frei, Akkorde bleiben dann aus
+    void setChord(bool enabled) { chord_ = enabled && N <= MAX_CHORD_BUTTON; }
+
+    void reset() {
+        for (size_t i = 0; i < N; i++) keys_[i] = Key();
+    }
+
+    void onEdge(uint8_t button, bool pressed, uint32_t nowMs, uint32_t edgeUs) {
+        if (button < 1 || button > N) return;
+        Key& k = keys_[button - 1];
+        if (pressed) {
+            if (chord_ && joinChord(button, nowMs, edgeUs)) return;
+            k.edgeUs = edgeUs;
+            k.pressMs = nowMs;
+        }
+        step(button, pressed ? IN_PRESS : IN_RELEASE, nowMs);
+    }
+
+    // Abgelaufene Fristen auswerten
+    void poll(uint32_t nowMs) {
+        for (size_t i = 0; i < N; i++) {
+            Key& k = keys_[i];
+            if (k.armed && (int32_t)(nowMs - k.deadline) >= 0) {
+                k.armed = false;
+                step((uint8_t)(i + 1), IN_TIMEOUT, nowMs);
+            }
+        }
+    }
+
+    // Zeit bis zur nächsten Frist (0 = sofort poll(), NO_DEADLINE = keine)
+    uint32_t timeUntilNext(uint32_t nowMs) const {
+        uint32_t best = NO_DEADLINE;
+        for (size_t i = 0; i < N; i++) {
+            if (!keys_[i].armed) continue;
+            const int32_t d = (int32_t)(keys_[i].deadline - nowMs);
+            const uint32_t wait = d > 0 ? (uint32_t)d : 0;
+            if (wait < best) best = wait;
+        }
+        return best;
+    }
+
+    bool idle() const {
+        for (size_t i = 0; i < N; i++)
+            if (keys_[i].state != ST_IDLE) return false;
+        return true;
+    }
+
+private:
+    struct Key {
+        State state = ST_IDLE;
+        bool armed = false;
+        uint32_t deadline = 0;
+        uint32_t pressMs = 0;
+        uint32_t edgeUs = 0;
+        uint32_t heldMs = 0;    // erstes Dauerfeuer bzw. langer Druck
+        uint32_t repeats = 0;   // seitdem gemeldete Wiederholungen
+    };
+
+    uint8_t mapFor(uint8_t button) const {
+        return (uint8_t)(map_[button - 1] | (chord_ ? MAP_CHORD : 0));
+    }
+
+    void step(uint8_t button, Input in, uint32_t nowMs) {
+        Key& k = keys_[button - 1];
+        const Transition& tr = TABLE.t[mapFor(button)][k.state][in];
+        if (tr.next == ST_HELD && k.state != ST_HELD) {
+            // Ein langer Druck belegt den ersten Platz der Folge
+            k.heldMs = nowMs;
+            k.repeats = tr.emit == EMIT_LONG ? 1 : 0;
+        }
+        k.state = tr.next;
+        uint8_t count = 1;
+        if (tr.emit == EMIT_REPEAT) {
+            const uint32_t due = repeatsDue(timing_, nowMs - k.heldMs) - k.repeats;
+            count = (uint8_t)(due < 255 ? due : 255);
+            k.repeats += count;
+        }
+        switch (tr.timer) {
+        case TIMER_KEEP: break;
+        case TIMER_STOP: k.armed = false; break;
+        case TIMER_CHORD: arm(k, nowMs, timing_.chordMs); break;
+        case TIMER_LONG: arm(k, nowMs, timing_.longMs); break;
+        case TIMER_DOUBLE: arm(k, nowMs, timing_.doubleMs); break;
+        case TIMER_REPEAT: {
+            const uint32_t interval = repeatIntervalAt(timing_, nowMs - k.heldMs);
+            arm(k, nowMs, interval > REPEAT_BATCH_MS ? interval : REPEAT_BATCH_MS);
+            break;
+        }
+        }
+        static const Gesture GESTURES[] = {GESTURE_CLICK, GESTURE_CLICK, GESTURE_LONG, GESTURE_DOUBLE, GESTURE_REPEAT};
+        if (tr.emit != EMIT_NONE && count > 0) emit_(code(button, GESTURES[tr.emit]), count, k.edgeUs, ctx_);
+    }
+
+    static void arm(Key& k, uint32_t nowMs, uint32_t ms) {
+        k.armed = true;
+        k.deadline = nowMs + ms;
+    }
+
+    // Zweite Taste, während eine andere noch im Akkord-Fenster steht
+    bool joinChord(uint8_t button, uint32_t nowMs, uint32_t edgeUs) {
+        for (size_t i = 0; i < N; i++) {
+            Key& k = keys_[button - 1];
+            Key& other = keys_[i];
+            if (k.state != ST_IDLE) return false;
+            if (i == (size_t)(button - 1) || other.state != ST_CHORD_WAIT) continue;
+            if (nowMs - other.pressMs > timing_.chordMs) continue;
+            other.state = k.state = ST_CHORD;
+            other.armed = k.armed = false;
+            k.edgeUs = edgeUs;
+            emit_(chordCode((uint8_t)(i + 1), button), 1, other.edgeUs, ctx_);
+            return true;
+        }
+        return false;
+    }
+
+    EmitFn emit_;
+    void* ctx_;
+    Timing timing_ = DEFAULT_TIMING;
+    uint8_t map_[N] = {};
+    bool chord_ = false;
+    Key keys_[N];
+};
+
+}  // namespace gesture
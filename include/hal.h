@@ -0,0 +1,135 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Dünne Hardware-Abstraktion für die Firmware-Logik in remote.cpp.
+// Implementiert in src/main.cpp (ESP32 / Arduino / NimBLE) und in
+// src/sim/sim_hal.cpp (native Build mit virtueller Uhr).
+
+// Funktionen, die aus einer ISR heraus laufen, müssen auf dem ESP32 im IRAM liegen
+// Daten mit HAL_RTC_DATA überstehen den Deep Sleep im RTC-Speicher
+#ifdef ARDUINO
+#include <esp_attr.h>
+#define HAL_ISR_ATTR IRAM_ATTR
+#define HAL_RTC_DATA RTC_DATA_ATTR
+#else
+#define HAL_ISR_ATTR
+#define HAL_RTC_DATA
+#endif
+
+namespace hal {
+
+enum Characteristic : uint8_t {
+    CHAR_BUTTON,
+    CHAR_BATTERY,
+    CHAR_HID_INPUT,   // Input-Report der HID-Tastatur (nur im HID-Modus)
+    CHAR_LOG,         // Download des Ereignis-Logs
+    CHAR_OTA,         // Status des Firmware-Updates (Steuer-Characteristic)
+    CHAR_TIME_SYNC,   // Antworten auf den Zeitabgleich (time_sync.h)
+};
+
+// --- Uhr ---
+uint32_t millis();
+uint32_t micros();
+// Läuft auch im Deep Sleep weiter (RTC), für Zeitstempel über Neustarts hinweg
+uint32_t rtcMillis();
+
+// --- GPIO / ADC ---
+// Konfiguriert alle Tasten aus BUTTON_KEYS (Pullup, aktiv LOW) mit Interrupt
+// auf beide Flanken. Jede Flanke landet in remote::onButtonEdge().
+void setupButtons();
+// Pegel aller Tasten mit einem Registerzugriff (bzw. einem Matrix-Scan)
+uint32_t readButtons();
+void setupLed(int pin);
+void writeLed(int pin, bool on);
+uint16_t readAdc(int pin);
+
+// --- BLE ---
+uint8_t bleConnectedCount();
+// Eine Verbindung, wie der Stack sie gerade sieht (Abgleich nach verlorenen Link-Ereignissen)
+struct BlePeer {
+    uint16_t conn;
+    uint16_t mtu;
+    bool subscribed;    // Tasten-Characteristic bzw. HID-Input-Report abonniert
+};
+// Höchstens max Verbindungen nach out, Rückgabe: Anzahl
+size_t blePeers(BlePeer* out, size_t max);
+bool isAdvertising();
+// Advertising mit festem Intervall (x0.625 ms) neu starten, 0 = beenden
+void bleAdvertise(uint16_t interval);
+// Neue Verbindungsparameter beim Central anfragen (Einheiten wie BLE-Spezifikation)
+void bleUpdateConnParams(uint16_t minInterval, uint16_t maxInterval, uint16_t latency, uint16_t timeout);
+// An eine Verbindung. false, wenn der Stack die Notification nicht annimmt
+// (keine Puffer frei, Verbindung weg); true ohne Senden, wenn conn die
+// Characteristic nicht abonniert hat
+bool bleNotify(Characteristic ch, uint16_t conn, const uint8_t* data, size_t len);
+// Signalstärke der Verbindung in dBm, 0 = unbekannt / nicht verbunden
+int8_t bleRssi();
+// Sendeleistung für Advertising und Verbindungen
+void bleSetTxPower(int8_t dbm);
+
+// --- Schlafen ---
+// Firmware-Tasks (remote::startTasks()), ohne eigene Tasks ist alles TASK_INPUT
+enum Task : uint8_t {
+    TASK_INPUT,
+    TASK_TX,
+    TASK_HOUSEKEEPING,
+    TASK_COUNT
+};
+
+// Blockiert den aufrufenden Task bis timeoutMs abgelaufen ist oder er mit
+// wake() bzw. (nur TASK_INPUT) wakeFromISR() geweckt wurde
+void waitForEvent(uint32_t timeoutMs);
+void wake(Task task = TASK_INPUT);
+void wakeFromISR();
+
+// Light Sleep bis timeoutMs oder Tastendruck. Nur sinnvoll, wenn das
+// Funkmodul nicht gebraucht wird (keine Verbindung, kein Advertising).
+void lightSleep(uint32_t timeoutMs);
+
+// Deep Sleep bis eine Taste drückt. Kehrt auf dem ESP32 nicht zurück,
+// die Firmware startet danach neu und wakeButton() sagt, welche Taste es war.
+void deepSleep();
+uint8_t wakeButton();   // 0 = normaler Start
+// rtcMillis() beim Druck der Weck-Taste (nur gültig, wenn wakeButton() != 0)
+uint32_t wakeMillis();
+
+// --- Einstellungen (NVS) ---
+// Liest höchstens len Bytes, Rückgabe: gelesene Länge (0 = nicht vorhanden)
+size_t settingsRead(const char* key, void* data, size_t len);
+bool settingsWrite(const char* key, const void* data, size_t len);
+
+// --- Flash für das Ereignis-Log (flash_log.h) ---
+// Eigener Bereich aus logFlashSectors() Sektoren; Schreiben kann nur Bits
+// löschen (1 -> 0), Löschen setzt einen Sektor auf 0xFF. 0 Sektoren = kein Log.
+size_t logFlashSectorSize();
+size_t logFlashSectors();
+bool logFlashRead(uint32_t addr, void* data, size_t len);
+bool logFlashWrite(uint32_t addr, const void* data, size_t len);
+bool logFlashErase(uint32_t sector);
+
+// --- Firmware-Update (ota_receiver.h) ---
+// Freier App-Slot (nächste OTA-Partition), 0 = kein Update möglich. Löschen
+// in ganzen Sektoren (4 KiB), Schreiben wie beim Log nur 1 -> 0.
+size_t otaCapacity();
+bool otaErase(uint32_t offset, size_t len);
+bool otaWrite(uint32_t offset, const void* data, size_t len);
+bool otaRead(uint32_t offset, void* data, size_t len);
+// Slot als Boot-Partition setzen (prüft das Image-Format), gilt ab restart()
+bool otaActivate(size_t imageSize);
+
+// Neustart wie nach Reset (kehrt auf dem ESP32 nicht zurück)
+void restart();
+
+// --- Start ---
+// Hardware, die Advertising und Tastenerfassung nicht brauchen (serielle
+// Ausgabe, WLAN aus, ADC, Energieverwaltung). Läuft einmal je Start im
+// Haushalts-Task, nach dem Start des Advertisings.
+void bootDeferred();
+
+// --- Log (trace_log.h) ---
+// Eine fertig formatierte Zeile ausgeben, ohne zu warten. false, wenn sie
+// gerade nicht ganz in den Sendepuffer passt (nichts wurde geschrieben).
+bool logWrite(const char* line, size_t len);
+
+}  // namespace hal
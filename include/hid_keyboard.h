@@ -0,0 +1,70 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// HID-Tastatur für den direkten Modus: Report-Map (Boot-Keyboard, Report-ID 1)
+// und Aufbau der 8-Byte-Input-Reports. Codes siehe USB HID Usage Tables, Kap. 10.
+namespace hid {
+
+const uint8_t REPORT_ID = 1;
+const size_t REPORT_SIZE = 8;   // Modifier, reserviert, 6 Tasten
+
+// Modifier-Bits
+enum Modifier : uint8_t {
+    MOD_CTRL = 0x01,
+    MOD_SHIFT = 0x02,
+    MOD_ALT = 0x04,
+    MOD_GUI = 0x08,
+};
+
+// Einige Usages der Keyboard-Page
+enum Usage : uint8_t {
+    KEY_NONE = 0x00,
+    KEY_ENTER = 0x28,
+    KEY_ESCAPE = 0x29,
+    KEY_SPACE = 0x2C,
+    KEY_F5 = 0x3E,
+    KEY_PAGE_UP = 0x4B,
+    KEY_PAGE_DOWN = 0x4E,
+    KEY_RIGHT = 0x4F,
+    KEY_LEFT = 0x50,
+    KEY_DOWN = 0x51,
+    KEY_UP = 0x52,
+};
+
+constexpr uint8_t REPORT_MAP[] = {
+    0x05, 0x01,        // Usage Page (Generic Desktop)
+    0x09, 0x06,        // Usage (Keyboard)
+    0xA1, 0x01,        // Collection (Application)
+    0x85, REPORT_ID,   //   Report ID
+    0x05, 0x07,        //   Usage Page (Keyboard)
+    0x19, 0xE0,        //   Usage Minimum (Left Control)
+    0x29, 0xE7,        //   Usage Maximum (Right GUI)
+    0x15, 0x00,        //   Logical Minimum (0)
+    0x25, 0x01,        //   Logical Maximum (1)
+    0x75, 0x01,        //   Report Size (1)
+    0x95, 0x08,        //   Report Count (8)
+    0x81, 0x02,        //   Input (Data, Var, Abs) - Modifier
+    0x95, 0x01,        //   Report Count (1)
+    0x75, 0x08,        //   Report Size (8)
+    0x81, 0x01,        //   Input (Const) - reserviert
+    0x95, 0x06,        //   Report Count (6)
+    0x75, 0x08,        //   Report Size (8)
+    0x15, 0x00,        //   Logical Minimum (0)
+    0x25, 0x65,        //   Logical Maximum (101)
+    0x05, 0x07,        //   Usage Page (Keyboard)
+    0x19, 0x00,        //   Usage Minimum (0)
+    0x29, 0x65,        //   Usage Maximum (101)
+    0x81, 0x00,        //   Input (Data, Array) - Tasten
+    0xC0,              // End Collection
+};
+
+// Input-Report für gedrückte Tasten; KEY_NONE und 0 = alles losgelassen
+inline void keyReport(uint8_t* out, uint8_t modifiers, uint8_t key) {
+    out[0] = modifiers;
+    out[1] = 0;
+    out[2] = key;
+    for (size_t i = 3; i < REPORT_SIZE; i++) out[i] = 0;
+}
+
+}  // namespace hid
@@ -0,0 +1,247 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "hid_keyboard.h"
+
+// Makros für den HID-Modus. Ein Makro ist Text wie "ctrl+pagedown, wait 30, enter":
+// Schritte durch Komma getrennt, Tasten eines Schritts mit '+', "wait N" wartet
+// N ms. build() übersetzt alle Makros einmal (beim Start bzw. nach einer
+// Konfigurationsänderung) in ein flaches Array fertiger Input-Reports; zur
+// Laufzeit wird nur noch kopiert und nach Zeit abgespielt, ohne zu blockieren.
+namespace hid {
+
+struct MacroSource {
+    uint8_t code;       // Code aus den Tasten-Paketen (Klick = ButtonId)
+    const char* keys;
+};
+
+// Ein Report und die Pause bis zum nächsten Report desselben Makros
+struct MacroReport {
+    uint8_t report[REPORT_SIZE];
+    uint16_t delayMs;
+};
+
+struct KeyName {
+    const char* name;
+    uint8_t usage;
+};
+
+constexpr KeyName KEY_NAMES[] = {
+    {"enter", KEY_ENTER},   {"esc", KEY_ESCAPE},  {"space", KEY_SPACE},         {"f5", KEY_F5},
+    {"pageup", KEY_PAGE_UP}, {"pagedown", KEY_PAGE_DOWN}, {"left", KEY_LEFT}, {"right", KEY_RIGHT},
+    {"up", KEY_UP},         {"down", KEY_DOWN},   {"tab", 0x2B},                {"backspace", 0x2A},
+    {"home", 0x4A},         {"end", 0x4D},        {"delete", 0x4C},
+};
+
+constexpr KeyName MODIFIER_NAMES[] = {
+    {"ctrl", MOD_CTRL}, {"shift", MOD_SHIFT}, {"alt", MOD_ALT}, {"gui", MOD_GUI},
+};
+
+// Name eines Schritts -> Modifier-Bit oder Usage (a-z, 0-9 direkt)
+inline bool lookupKey(const char* s, size_t len, uint8_t& modifier, uint8_t& usage) {
+    modifier = usage = 0;
+    if (len == 1 && s[0] >= 'a' && s[0] <= 'z') usage = (uint8_t)(0x04 + s[0] - 'a');
+    else if (len == 1 && s[0] >= '1' && s[0] <= '9') usage = (uint8_t)(0x1E + s[0] - '1');
+    else if (len == 1 && s[0] == '0') usage = 0x27;
+    for (const KeyName& k : MODIFIER_NAMES)
+        if (strlen(k.name) == len && strncmp(k.name, s, len) == 0) modifier = k.usage;
+    for (const KeyName& k : KEY_NAMES)
+        if (strlen(k.name) == len && strncmp(k.name, s, len) == 0) usage = k.usage;
+    return modifier || usage;
+}
+
+// Übersetzte Makros: Reports aller Makros hintereinander, je Makro ein Bereich
+template <size_t MAX_REPORTS, size_t MAX_MACROS>
+class MacroTable {
+public:
+    struct Entry {
+        uint8_t code;
+        uint16_t first;
+        uint16_t count;
+    };
+
+    // false bei unbekanntem Namen oder zu wenig Platz; die Tabelle ist dann leer
+    bool build(const MacroSource* sources, size_t n) {
+        reportCount_ = macroCount_ = 0;
+        for (size_t i = 0; i < n; i++) {
+            if (macroCount_ == MAX_MACROS || !compile(sources[i])) {
+                reportCount_ = macroCount_ = 0;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    const Entry* find(uint8_t code) const {
+        for (size_t i = 0; i < macroCount_; i++)
+            if (macros_[i].code == code) return &macros_[i];
+        return nullptr;
+    }
+
+    const MacroReport& report(size_t i) const { return reports_[i]; }
+    size_t reportCount() const { return reportCount_; }
+
+private:
+    bool compile(const MacroSource& src) {
+        Entry e = {src.code, (uint16_t)reportCount_, 0};
+        const char* p = src.keys;
+        while (*p) {
+            while (*p == ' ' || *p == ',') p++;
+            if (!*p) break;
+            const char* end = p;
+            while (*end && *end != ',') end++;
+            size_t len = (size_t)(end - p);
+            while (len > 0 && p[len - 1] == ' ') len--;
+
+            if (len > 5 && strncmp(p, "wait ", 5) == 0) {
+                // Pause hängt am letzten Report (dem Loslassen) des vorigen Schritts
+                if (e.count == 0) return false;
+                unsigned ms = 0;
+                for (size_t i = 5; i < len; i++) {
+                    if (p[i] < '0' || p[i] > '9') return false;
+                    ms = ms * 10 + (unsigned)(p[i] - '0');
+                }
+                const unsigned total = reports_[reportCount_ - 1].delayMs + ms;
+                reports_[reportCount_ - 1].delayMs = total > 0xFFFF ? 0xFFFF : (uint16_t)total;
+            } else if (!compileStep(p, len, e)) {
+                return false;
+            }
+            p = end;
+        }
+        if (e.count == 0) return false;
+        macros_[macroCount_++] = e;
+        return true;
+    }
+
+    // Ein Schritt: Drücken-Report mit allen Tasten, dann Loslassen-Report
+    // (immer als Paar, MacroPlayer::run() verlässt sich darauf)
+    bool compileStep(const char* p, size_t len, Entry& e) {
+        if (reportCount_ + 2 > MAX_REPORTS) return false;
+        uint8_t modifiers = 0;
+        uint8_t keys[6] = {};
+        size_t keyCount = 0;
+        const char* end = p + len;
+        while (p < end) {
+            const char* plus = p;
+            while (plus < end && *plus != '+') plus++;
+            uint8_t mod, usage;
+            if (!lookupKey(p, (size_t)(plus - p), mod, usage)) return false;
+            modifiers |= mod;
+            if (usage) {
+                if (keyCount == 6) return false;
+                keys[keyCount++] = usage;
+            }
+            p = plus < end ? plus + 1 : end;
+        }
+        MacroReport& press = reports_[reportCount_++];
+        keyReport(press.report, modifiers, KEY_NONE);
+        for (size_t i = 0; i < keyCount; i++) press.report[2 + i] = keys[i];
+        press.delayMs = 0;
+        MacroReport& release = reports_[reportCount_++];
+        keyReport(release.report, 0, KEY_NONE);
+        release.delayMs = 0;
+        e.count += 2;
+        return true;
+    }
+
+    MacroReport reports_[MAX_REPORTS];
+    Entry macros_[MAX_MACROS];
+    size_t reportCount_ = 0;
+    size_t macroCount_ = 0;
+};
+
+// Spielt Makros nacheinander ab. Neue Drücke landen in einer Warteschlange,
+// während ein Makro mit Pausen noch läuft; der Aufrufer ruft run() zu
+// timeUntilNext() (Timer) und direkt nach enqueue().
+template <class Table, size_t QUEUE>
+class MacroPlayer {
+public:
+    static const uint32_t NO_DEADLINE = 0xFFFFFFFF;
+
+    explicit MacroPlayer(const Table& table) : table_(table) {}
+
+    // false, wenn der Code kein Makro hat oder die Warteschlange voll ist (full())
+    bool enqueue(uint8_t code, uint32_t edgeUs, uint32_t nowMs) {
+        const typename Table::Entry* e = table_.find(code);
+        if (!e || queued_ == QUEUE) return false;
+        queue_[(head_ + queued_) % QUEUE] = {e, edgeUs};
+        if (queued_++ == 0 && !playing_) startNext(nowMs);
+        return true;
+    }
+
+    // Sendet alle fälligen Reports: send(report, len, edgeUs, erster Report des Makros).
+    // room: so viele Reports nimmt der Aufrufer jetzt sicher an. Drücken und
+    // Loslassen eines Schritts gehen nur zusammen raus, sonst bliebe beim Host
+    // eine Taste hängen; passt das Paar nicht, wartet der Schritt (blocked()).
+    template <class SendFn>
+    void run(uint32_t nowMs, size_t room, SendFn send) {
+        while (playing_ && (int32_t)(nowMs - due_) >= 0) {
+            // Makro fertig, auch eine Pause am Ende ist abgelaufen
+            if (pos_ == current_.entry->count) {
+                playing_ = false;
+                if (queued_ > 0) startNext(due_);
+                continue;
+            }
+            if (room < 2) {
+                blocked_ = true;
+                return;
+            }
+            // Nach einem Stau zählt die folgende Pause ab jetzt
+            if (blocked_) due_ = nowMs;
+            blocked_ = false;
+            const MacroReport& press = table_.report(current_.entry->first + pos_);
+            const MacroReport& release = table_.report(current_.entry->first + pos_ + 1);
+            send(press.report, REPORT_SIZE, current_.edgeUs, pos_ == 0);
+            send(release.report, REPORT_SIZE, current_.edgeUs, false);
+            room -= 2;
+            due_ += press.delayMs + release.delayMs;
+            pos_ += 2;
+        }
+    }
+
+    // Ein fälliger Schritt wartet auf Platz beim Aufrufer
+    bool blocked() const { return blocked_; }
+
+    bool full() const { return queued_ == QUEUE; }
+
+    uint32_t timeUntilNext(uint32_t nowMs) const {
+        if (!playing_) return NO_DEADLINE;
+        const int32_t d = (int32_t)(due_ - nowMs);
+        return d > 0 ? (uint32_t)d : 0;
+    }
+
+    bool idle() const { return !playing_ && queued_ == 0; }
+
+    void clear() {
+        playing_ = blocked_ = false;
+        queued_ = head_ = 0;
+    }
+
+private:
+    struct Run {
+        const typename Table::Entry* entry;
+        uint32_t edgeUs;
+    };
+
+    void startNext(uint32_t atMs) {
+        current_ = queue_[head_];
+        head_ = (head_ + 1) % QUEUE;
+        queued_--;
+        pos_ = 0;
+        due_ = atMs;
+        playing_ = true;
+    }
+
+    const Table& table_;
+    Run queue_[QUEUE];
+    size_t head_ = 0;
+    size_t queued_ = 0;
+    Run current_ = {nullptr, 0};
+    uint16_t pos_ = 0;
+    uint32_t due_ = 0;
+    bool playing_ = false;
+    bool blocked_ = false;
+};
+
+}  // namespace hid
@@ -0,0 +1,46 @@
+#pragma once
+#include <cstdint>
+
+// Histogramm mit logarithmischen Buckets (Zweierpotenzen in µs) für
+// Latenzmessungen auf dem Gerät. record() kostet ein clz, ein Inkrement
+// und zwei Vergleiche, kein Heap. Perzentile sind auf den Bucket genau
+// (Obergrenze des Buckets, begrenzt durch das gemessene Maximum).
+class LatencyHistogram {
+public:
+    static constexpr int BUCKETS = 33;   // Bucket i: Werte < 2^i (Bucket 0: Wert 0)
+
+    void record(uint32_t us) {
+        const int b = us == 0 ? 0 : 32 - __builtin_clz(us);
+        buckets_[b]++;
+        count_++;
+        if (us < min_) min_ = us;
+        if (us > max_) max_ = us;
+    }
+
+    void reset() { *this = LatencyHistogram(); }
+
+    uint32_t count() const { return count_; }
+    uint32_t min() const { return count_ ? min_ : 0; }
+    uint32_t max() const { return max_; }
+
+    // percent in 0..100, z.B. 50 oder 99
+    uint32_t percentile(uint32_t percent) const {
+        if (count_ == 0) return 0;
+        const uint64_t rank = ((uint64_t)count_ * percent + 99) / 100;
+        uint64_t seen = 0;
+        for (int b = 0; b < BUCKETS; b++) {
+            seen += buckets_[b];
+            if (seen >= rank && seen > 0) {
+                const uint32_t upper = b == 0 ? 0 : b >= 32 ? 0xFFFFFFFF : (1u << b) - 1;
+                return upper < max_ ? upper : max_;
+            }
+        }
+        return max_;
+    }
+
+private:
+    uint32_t buckets_[BUCKETS] = {};
+    uint32_t count_ = 0;
+    uint32_t min_ = 0xFFFFFFFF;
+    uint32_t max_ = 0;
+};
@@ -0,0 +1,91 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Mehrere Centrals gleichzeitig (z.B. Präsentations-Laptop und Aufnahme-PC).
+// Jede Verbindung hat ihren eigenen Abo-Zustand und ihre MTU. Die Tabelle
+// gehört der loop(); die BLE-Callbacks schicken nur Ereignisse (EventRing).
+// Der BLE-TX-Task bekommt Kopien und sendet an jede Verbindung einzeln; ein
+// langsamer Central bremst die Schlange, verliert aber nichts.
+namespace link {
+
+enum EventType : uint8_t {
+    LINK_UP,
+    LINK_DOWN,
+    LINK_SUBSCRIBE,     // value: 1 = abonniert, 0 = abbestellt
+    LINK_MTU,           // value: ausgehandelte ATT-MTU
+};
+
+struct Event {
+    uint8_t type;
+    uint16_t conn;      // Connection-Handle
+    uint16_t value;
+};
+
+struct Link {
+    uint16_t conn;
+    uint16_t mtu;
+    bool subscribed;
+};
+
+const uint16_t DEFAULT_MTU = 23;
+
+template <size_t N>
+class Table {
+public:
+    // false, wenn das Ereignis nichts ändert (unbekannte Verbindung, Tabelle voll)
+    bool apply(const Event& e) {
+        Link* l = find(e.conn);
+        switch (e.type) {
+        case LINK_UP:
+            if (l || count_ == N) return false;
+            links_[count_++] = {e.conn, DEFAULT_MTU, false};
+            return true;
+        case LINK_DOWN:
+            if (!l) return false;
+            *l = links_[--count_];
+            return true;
+        case LINK_SUBSCRIBE:
+            if (!l || l->subscribed == (e.value != 0)) return false;
+            l->subscribed = e.value != 0;
+            return true;
+        case LINK_MTU:
+            if (!l) return false;
+            l->mtu = e.value;
+            return true;
+        }
+        return false;
+    }
+
+    void clear() { count_ = 0; }
+
+    size_t connected() const { return count_; }
+
+    size_t subscribed() const {
+        size_t n = 0;
+        for (size_t i = 0; i < count_; i++) n += links_[i].subscribed;
+        return n;
+    }
+
+    const Link& operator[](size_t i) const { return links_[i]; }
+
+    // Log-Blöcke gehen an alle Verbindungen -> müssen in die kleinste MTU passen
+    uint16_t minMtu() const {
+        uint16_t m = 0;
+        for (size_t i = 0; i < count_; i++)
+            if (m == 0 || links_[i].mtu < m) m = links_[i].mtu;
+        return m ? m : DEFAULT_MTU;
+    }
+
+private:
+    Link* find(uint16_t conn) {
+        for (size_t i = 0; i < count_; i++)
+            if (links_[i].conn == conn) return &links_[i];
+        return nullptr;
+    }
+
+    Link links_[N];
+    size_t count_ = 0;
+};
+
+}  // namespace link
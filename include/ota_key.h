@@ -0,0 +1,34 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Öffentlicher Schlüssel für Firmware-Updates (ECDSA P-256, DER wie
+// `openssl ec -pubout -outform DER`). Nur Images, deren SHA-256 mit dem
+// passenden privaten Schlüssel signiert ist, werden geschrieben
+// (ota_receiver.h).
+
+#ifdef ARDUINO
+// Der eigene Schlüssel steht in include/ota_key_local.h (nicht im
+// Repository, siehe README):
+//   const uint8_t OTA_PUBLIC_KEY[] = {0x30, 0x59, ...};
+// Ohne ihn baut die Firmware nicht, statt still einen bekannten Schlüssel
+// zu nehmen.
+#if __has_include("ota_key_local.h")
+#include "ota_key_local.h"
+#else
+#error "include/ota_key_local.h fehlt: öffentlichen OTA-Schlüssel eintragen (README, Firmware-Update)"
+#endif
+
+#else
+// Testschlüssel nur für den Simulator; sein privater Teil steht in
+// src/sim/sim_main.cpp.
+const uint8_t OTA_TEST_PUBLIC_KEY[] = {
+    0x30, 0x59, 0x30, 0x13, 0x06, 0x07, 0x2a, 0x86, 0x48, 0xce, 0x3d, 0x02, 0x01, 0x06, 0x08, 0x2a,
+    0x86, 0x48, 0xce, 0x3d, 0x03, 0x01, 0x07, 0x03, 0x42, 0x00, 0x04, 0x5d, 0x9a, 0xc3, 0x52, 0xf3,
+    0x64, 0x47, 0xaf, 0x1a, 0x25, 0x2b, 0xae, 0x59, 0x90, 0x25, 0xf1, 0x2f, 0x49, 0x8d, 0x33, 0x7a,
+    0xfb, 0x00, 0xc9, 0x0b, 0xf1, 0x5b, 0x87, 0x7b, 0xe6, 0xb7, 0xca, 0xfa, 0x6d, 0x8f, 0xd1, 0xe7,
+    0xdf, 0x47, 0x59, 0xb8, 0x54, 0xf4, 0x02, 0x53, 0x39, 0x33, 0x44, 0x43, 0x8e, 0xc4, 0x06, 0x0e,
+    0x46, 0xf5, 0x3a, 0xde, 0x67, 0xcd, 0xaf, 0xea, 0x28, 0x6e, 0xb7,
+};
+#define OTA_PUBLIC_KEY OTA_TEST_PUBLIC_KEY
+#endif
@@ -0,0 +1,324 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "mbedtls/md.h"
+#include "mbedtls/pk.h"
+
+// Firmware-Update über BLE. Der Host schickt das Image als Write Without
+// Response in Stücken (Chunks) auf die Daten-Characteristic:
+//   uint32 Offset, Nutzdaten, uint32 CRC-32 der Nutzdaten   (little endian)
+// Der BLE-Task prüft jeden Chunk und kopiert ihn in einen von zwei Blockpuffern.
+// Ist ein Block voll, schreibt der Haushalts-Task ihn in den Flash, während
+// der BLE-Task schon den anderen füllt -> Funk und Flash laufen überlappend,
+// und die Eingabe wartet nie auf den Flash.
+//
+// Flusskontrolle: der Host darf höchstens WINDOW Bytes über den zuletzt
+// bestätigten (geschriebenen) Offset hinaus senden. Passt ein Chunk nicht
+// (CRC, Lücke, kein Puffer frei), verwirft der Empfänger ihn und alle
+// folgenden, bis der Host ab dem gemeldeten Offset neu sendet. Nach einem
+// Verbindungsabbruch setzt OTA_CMD_BEGIN mit demselben Image beim letzten
+// geschriebenen Block fort. Am Ende wird das Image aus dem Flash zurückgelesen
+// und gegen den SHA-256 aus OTA_CMD_BEGIN geprüft, erst dann umgeschaltet.
+//
+// Echtheit: OTA_CMD_BEGIN trägt eine ECDSA-Signatur (P-256, DER wie von
+// `openssl dgst -sha256 -sign`) über diesen SHA-256. Passt sie nicht zum
+// eingebauten öffentlichen Schlüssel (ota_key.h), wird nichts gelöscht oder
+// geschrieben. Da am Ende genau dieser Hash geprüft wird, startet nur ein
+// signiertes Image. Hash und Signatur rechnet mbedTLS (im ESP-IDF enthalten,
+// im Simulator libmbedcrypto).
+//
+// Ziel-Schnittstelle (Template-Parameter, Instanz):
+//   size_t capacity() const
+//   bool erase(uint32_t offset, size_t len)      // ganze BLOCK_SIZE-Blöcke
+//   bool write(uint32_t offset, const void* data, size_t len)
+//   bool read(uint32_t offset, void* buf, size_t len)
+//   bool activate(size_t imageSize)              // als Boot-Partition setzen
+namespace ota {
+
+const size_t BLOCK_SIZE = 4096;               // = Flash-Sektor
+const size_t WINDOW = 2 * BLOCK_SIZE;
+const size_t CHUNK_OVERHEAD = 8;              // Offset + CRC
+const size_t DIGEST_SIZE = 32;                // SHA-256
+const size_t MAX_SIGNATURE_SIZE = 72;         // ECDSA P-256 in DER
+const size_t BEGIN_HEADER = 1 + 4 + DIGEST_SIZE;
+const size_t BEGIN_MAX_SIZE = BEGIN_HEADER + MAX_SIGNATURE_SIZE;
+
+// Steuer-Characteristic, Host -> Gerät
+enum Command : uint8_t {
+    OTA_CMD_BEGIN = 1,    // uint32 Größe, 32 Bytes SHA-256 des Images, Signatur (DER, Rest)
+    OTA_CMD_FINISH = 2,   // alles gesendet: prüfen und umschalten
+    OTA_CMD_ABORT = 3,
+};
+
+// Steuer-Characteristic, Gerät -> Host (Notification): Status, uint32 Offset
+enum Status : uint8_t {
+    OTA_READY = 1,        // Offset: ab hier senden (0 oder Fortsetzung)
+    OTA_PROGRESS,         // Offset: bis hier im Flash
+    OTA_RESEND,           // Offset: ab hier erneut senden
+    OTA_DONE,             // Image geprüft, Gerät startet neu
+    OTA_ERR_SIZE,         // Image größer als die Partition
+    OTA_ERR_STATE,        // Befehl passt nicht (kein BEGIN, noch nicht komplett)
+    OTA_ERR_FLASH,
+    OTA_ERR_HASH,         // Prüfsumme falsch, Update verworfen
+    OTA_ERR_SIGNATURE,    // Signatur passt nicht zum eingebauten Schlüssel
+};
+
+const size_t STATUS_SIZE = 5;
+
+// CRC-32 (IEEE 802.3), Tabelle zur Übersetzungszeit
+struct Crc32Table {
+    uint32_t v[256];
+};
+
+constexpr Crc32Table makeCrc32Table() {
+    Crc32Table t = {};
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int b = 0; b < 8; b++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        t.v[i] = c;
+    }
+    return t;
+}
+
+constexpr Crc32Table CRC32_TABLE = makeCrc32Table();
+
+inline uint32_t crc32(const uint8_t* data, size_t len) {
+    uint32_t c = 0xFFFFFFFFu;
+    for (size_t i = 0; i < len; i++) c = CRC32_TABLE.v[(c ^ data[i]) & 0xFF] ^ (c >> 8);
+    return c ^ 0xFFFFFFFFu;
+}
+
+inline uint32_t getU32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+inline void putU32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+// Signatur über einen SHA-256 gegen einen öffentlichen Schlüssel (DER,
+// SubjectPublicKeyInfo wie `openssl ec -pubout -outform DER`)
+inline bool verifySignature(const uint8_t* publicKey, size_t keyLen, const uint8_t* sha, const uint8_t* signature,
+                            size_t signatureLen) {
+    mbedtls_pk_context pk;
+    mbedtls_pk_init(&pk);
+    const bool ok = mbedtls_pk_parse_public_key(&pk, publicKey, keyLen) == 0 &&
+                    mbedtls_pk_verify(&pk, MBEDTLS_MD_SHA256, sha, DIGEST_SIZE, signature, signatureLen) == 0;
+    mbedtls_pk_free(&pk);
+    return ok;
+}
+
+// Ergebnis von onChunk(): wer geweckt werden muss
+enum ChunkResult : uint8_t {
+    CHUNK_OK,
+    CHUNK_BLOCK_READY,    // Block voll, liegt für den Haushalt bereit
+    CHUNK_REJECTED,       // verworfen, Host muss ab resend-Offset neu senden
+};
+
+template <class Target>
+class Receiver {
+public:
+    // publicKey: P-256 als DER (verifySignature())
+    Receiver(Target& target, const uint8_t* publicKey, size_t keyLen)
+        : target_(target), publicKey_(publicKey), keyLen_(keyLen) {}
+
+    // --- BLE-Task ---
+    ChunkResult onChunk(const uint8_t* data, size_t len) {
+        if (!active_.load(std::memory_order_acquire)) return CHUNK_OK;
+        const uint32_t resync = resync_.exchange(NO_OFFSET, std::memory_order_acq_rel);
+        if (resync != NO_OFFSET) {
+            expected_ = resync;
+            if (fill_ >= 0) slots_[fill_].state.store(SLOT_FREE, std::memory_order_release);
+            fill_ = -1;
+            rejecting_ = false;
+        }
+        if (len <= CHUNK_OVERHEAD) return reject();
+        const uint32_t offset = getU32(data);
+        const uint8_t* payload = data + 4;
+        size_t n = len - CHUNK_OVERHEAD;
+        const uint32_t size = size_.load(std::memory_order_relaxed);
+        if (offset != expected_ || offset + n > size || crc32(payload, n) != getU32(payload + n)) return reject();
+
+        ChunkResult result = CHUNK_OK;
+        while (n > 0) {
+            if (fill_ < 0) {
+                fill_ = freeSlot();
+                if (fill_ < 0) return reject();   // Host hält das Fenster nicht ein
+                slots_[fill_].offset = expected_;
+                slots_[fill_].len = 0;
+            }
+            Slot& s = slots_[fill_];
+            size_t take = BLOCK_SIZE - s.len;
+            if (take > n) take = n;
+            memcpy(s.data + s.len, payload, take);
+            s.len += take;
+            payload += take;
+            n -= take;
+            expected_ += take;
+            if (s.len == BLOCK_SIZE || expected_ == size) {
+                s.state.store(SLOT_FULL, std::memory_order_release);
+                fill_ = -1;
+                result = CHUNK_BLOCK_READY;
+            }
+        }
+        rejecting_ = false;
+        return result;
+    }
+
+    // --- Haushalt ---
+    // Neues Update oder Fortsetzung desselben Images. Rückgabe OTA_READY mit
+    // resumeAt, sonst ein Fehler. Ein laufendes Update bleibt bei einer
+    // falschen Signatur unberührt.
+    Status begin(uint32_t size, const uint8_t* sha, const uint8_t* signature, size_t signatureLen, uint32_t& resumeAt) {
+        if (size == 0 || size > target_.capacity()) return OTA_ERR_SIZE;
+        if (!verifySignature(publicKey_, keyLen_, sha, signature, signatureLen)) return OTA_ERR_SIGNATURE;
+        if (active_.load() && size == size_.load() && memcmp(sha, sha_, sizeof(sha_)) == 0) {
+            if (!service()) return fail(OTA_ERR_FLASH);
+            resumeAt = committed();
+            resync_.store(resumeAt, std::memory_order_release);
+            return OTA_READY;
+        }
+        active_.store(false, std::memory_order_release);
+        for (Slot& s : slots_) {
+            if (s.state.load(std::memory_order_acquire) == SLOT_FULL) s.state.store(SLOT_FREE);
+        }
+        size_.store(size);
+        memcpy(sha_, sha, sizeof(sha_));
+        committed_.store(0, std::memory_order_release);
+        resend_.store(NO_OFFSET);
+        resync_.store(0);
+        active_.store(true, std::memory_order_release);
+        resumeAt = 0;
+        return OTA_READY;
+    }
+
+    // Volle Blöcke in Offset-Reihenfolge löschen und schreiben. false bei einem
+    // Flash-Fehler (Update ist dann verworfen).
+    bool service() {
+        for (;;) {
+            const uint32_t done = committed_.load(std::memory_order_relaxed);
+            Slot* next = nullptr;
+            for (Slot& s : slots_) {
+                if (s.state.load(std::memory_order_acquire) != SLOT_FULL) continue;
+                if (s.offset == done) next = &s;
+                else if (s.offset < done) s.state.store(SLOT_FREE, std::memory_order_release);   // alt, vor einer Fortsetzung gefüllt
+            }
+            if (!next) return true;
+            if (!target_.erase(next->offset, BLOCK_SIZE) || !target_.write(next->offset, next->data, next->len)) {
+                fail(OTA_ERR_FLASH);
+                return false;
+            }
+            committed_.store(done + next->len, std::memory_order_release);
+            next->state.store(SLOT_FREE, std::memory_order_release);
+        }
+    }
+
+    // Alles geschrieben? Dann zurücklesen, Hash prüfen, umschalten.
+    Status finish() {
+        if (!active_.load()) return OTA_ERR_STATE;
+        if (!service()) return OTA_ERR_FLASH;
+        const uint32_t done = committed();
+        if (done != size_.load()) return OTA_ERR_STATE;
+        uint8_t digest[DIGEST_SIZE];
+        const Status read = hashImage(done, digest);
+        if (read != OTA_DONE) return fail(read);
+        if (memcmp(digest, sha_, sizeof(digest)) != 0) return fail(OTA_ERR_HASH);
+        if (!target_.activate(done)) return fail(OTA_ERR_FLASH);
+        active_.store(false, std::memory_order_release);
+        return OTA_DONE;
+    }
+
+    void abort() { active_.store(false, std::memory_order_release); }
+
+    // --- Eingabe ---
+    // Der BLE-Task hat Chunks verworfen: ab offset neu senden lassen (einmalig)
+    bool takeResend(uint32_t& offset) {
+        offset = resend_.exchange(NO_OFFSET, std::memory_order_acq_rel);
+        return offset != NO_OFFSET;
+    }
+
+    bool active() const { return active_.load(std::memory_order_acquire); }
+    // Bis hier im Flash (vom Haushalt geschrieben)
+    uint32_t committed() const { return committed_.load(std::memory_order_acquire); }
+    uint32_t size() const { return size_.load(); }
+
+private:
+    static const uint32_t NO_OFFSET = 0xFFFFFFFF;
+
+    enum SlotState : uint8_t { SLOT_FREE, SLOT_FILLING, SLOT_FULL };
+
+    struct Slot {
+        std::atomic<uint8_t> state{SLOT_FREE};
+        uint32_t offset = 0;
+        size_t len = 0;
+        uint8_t data[BLOCK_SIZE];
+    };
+
+    int freeSlot() {
+        for (int i = 0; i < 2; i++) {
+            uint8_t expect = SLOT_FREE;
+            if (slots_[i].state.compare_exchange_strong(expect, SLOT_FILLING, std::memory_order_acquire)) return i;
+        }
+        return -1;
+    }
+
+    // Erster verworfener Chunk einer Folge meldet den Offset, die übrigen
+    // (schon unterwegs) werden still verworfen
+    ChunkResult reject() {
+        if (rejecting_) return CHUNK_OK;
+        rejecting_ = true;
+        resend_.store(expected_, std::memory_order_release);
+        return CHUNK_REJECTED;
+    }
+
+    // SHA-256 über die ersten len Bytes im Flash
+    Status hashImage(uint32_t len, uint8_t* digest) {
+        mbedtls_md_context_t md;
+        mbedtls_md_init(&md);
+        Status status = OTA_DONE;
+        if (mbedtls_md_setup(&md, mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), 0) != 0 || mbedtls_md_starts(&md) != 0) {
+            status = OTA_ERR_HASH;
+        }
+        uint8_t buf[256];
+        for (uint32_t off = 0; status == OTA_DONE && off < len; off += sizeof(buf)) {
+            const size_t n = len - off < sizeof(buf) ? len - off : sizeof(buf);
+            if (!target_.read(off, buf, n)) status = OTA_ERR_FLASH;
+            else if (mbedtls_md_update(&md, buf, n) != 0) status = OTA_ERR_HASH;
+        }
+        if (status == OTA_DONE && mbedtls_md_finish(&md, digest) != 0) status = OTA_ERR_HASH;
+        mbedtls_md_free(&md);
+        return status;
+    }
+
+    Status fail(Status s) {
+        active_.store(false, std::memory_order_release);
+        return s;
+    }
+
+    Target& target_;
+    const uint8_t* publicKey_;
+    size_t keyLen_;
+    Slot slots_[2];
+
+    // Nur BLE-Task
+    uint32_t expected_ = 0;
+    int fill_ = -1;
+    bool rejecting_ = false;
+
+    // Nur Haushalt
+    uint8_t sha_[DIGEST_SIZE] = {};
+
+    // Übergaben zwischen den Tasks
+    std::atomic<bool> active_{false};
+    std::atomic<uint32_t> size_{0};
+    std::atomic<uint32_t> committed_{0};        // Haushalt -> Eingabe: Fortschritt
+    std::atomic<uint32_t> resync_{NO_OFFSET};   // Haushalt -> BLE-Task: neu ab Offset
+    std::atomic<uint32_t> resend_{NO_OFFSET};   // BLE-Task -> Eingabe: Host soll neu senden
+};
+
+}  // namespace ota
@@ -0,0 +1,144 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "adv_scheduler.h"
+
+// Firmware-Zustandsmaschine, unabhängig von Arduino/NimBLE (nur hal.h).
+namespace remote {
+
+// Gestufter Start: begin() macht nur, was Advertising und Tastenerfassung
+// brauchen. Flash-Log, erster Akkuwert und hal::bootDeferred() folgen im
+// ersten Durchlauf des Haushalts, wenn das Advertising schon läuft.
+// sequential: alles schon in begin() wie früher, für den Vergleich im Simulator.
+void begin(bool sequential = false);
+// Ohne eigene Tasks (Simulator): ein Durchlauf aller drei Stufen, schläft
+// danach bis zum nächsten Timer oder bis eine ISR / ein Callback weckt.
+void loop();
+
+// --- TASKS ---
+// Mit eigenen Tasks (main.cpp): nach begin() einmal startTasks(), danach ruft
+// jeder Task seine Funktion endlos auf; loop() wird dann nicht benutzt. Jede
+// Funktion schläft selbst bis zur nächsten Aufgabe. Die Stufen tauschen nur
+// über die lock-freien Schlangen aus task_queues.h Daten aus.
+void startTasks();
+void inputTask();          // Tasten, Gesten, Verbindungen, Konfiguration, OTA-Status
+void txTask();             // alle Notifications
+void housekeepingTask();   // Akku, Flash-Log, OTA-Flash, serielle Log-Ausgabe
+
+// Aus der Tasten-ISR (bzw. dem Simulator) für jede Flanke, mit dem Pegel
+// aller Tasten als Maske (Bit i = Taste i+1 gedrückt)
+void onButtonEdge(uint32_t mask, uint32_t timeUs);
+
+// Aus den BLE-Callbacks, je Verbindung (Connection-Handle). Bis zu
+// MAX_CENTRALS Hosts können gleichzeitig verbunden sein.
+void onConnectionChanged(uint16_t conn, bool connected);
+// Host hat die Notifications der Tasten-Characteristic (ab)bestellt
+void onButtonSubscribed(uint16_t conn, bool subscribed);
+// Central hat Verbindungsintervall (x1.25 ms) / Peripheral Latency gesetzt
+void onConnParamsUpdated(uint16_t interval, uint16_t latency);
+
+// --- MODUS ---
+// Bridge: Codes über die eigene Characteristic, die App macht daraus Tasten.
+// HID: das Gerät ist selbst eine BLE-Tastatur (HID_MACROS), ohne App dazwischen.
+// Steht im NVS ("mode"); ein Wechsel wird gespeichert und startet neu.
+enum Mode : uint8_t {
+    MODE_BRIDGE,
+    MODE_HID,
+    MODE_COUNT
+};
+
+// Gültig ab begin(), main.cpp baut danach das GATT-Profil auf
+Mode mode();
+// Host hat die Modus-Characteristic beschrieben
+void onModeWrite(uint8_t mode);
+
+// --- EREIGNIS-LOG ---
+// Befehl auf der Log-Characteristic. Auf LOG_CMD_DOWNLOAD schickt das Gerät
+// alle Datensätze (flashlog::Record, ältester zuerst) als Notifications:
+//   uint16 Blocknummer, dann so viele ganze Datensätze, wie in MTU-3 passen.
+// Den Abschluss bildet ein Block mit Nummer 0xFFFF und uint16 Anzahl Datensätze.
+enum LogCommand : uint8_t {
+    LOG_CMD_DOWNLOAD = 1,
+    LOG_CMD_ERASE = 2,
+};
+
+const uint16_t LOG_END_BLOCK = 0xFFFF;
+
+void onLogCommand(uint8_t cmd);
+// Ausgehandelte ATT-MTU einer Verbindung
+void onMtuChanged(uint16_t conn, uint16_t mtu);
+
+// --- KONFIGURATION ---
+// Host schreibt einen TLV-Blob (device_config.h) auf die Konfigurations-
+// Characteristic. Er wird in der loop() geprüft, im NVS gespeichert und
+// sofort übernommen; nur der Gerätename wirkt erst nach dem Neustart.
+void onConfigWrite(const uint8_t* data, size_t len);
+// Lesen: [0] cfg::Error des letzten Schreibens, dann der gültige Blob
+// (leer = Standardwerte). Höchstens 1 + cfg::MAX_BLOB Bytes.
+size_t readConfig(uint8_t* out, size_t maxLen);
+
+// Gültig ab begin(), für den Aufbau des BLE-Stacks in main.cpp
+const char* deviceName();
+int8_t txPowerDbm();
+
+// --- FIRMWARE-UPDATE ---
+// Steuer-Characteristic (ota::Command, Antworten als Notification) und
+// Daten-Characteristic (Write Without Response), Protokoll in ota_receiver.h.
+// Daten-Chunks prüft und puffert schon der BLE-Task, den Flash schreibt der
+// Haushalt. Beide Characteristics verlangen eine verschlüsselte Verbindung.
+void onOtaCommand(const uint8_t* data, size_t len);
+void onOtaData(const uint8_t* data, size_t len);
+
+// --- ZEITABGLEICH ---
+// Host schreibt eine Anfrage (time_sync.h) auf die Zeitabgleich-
+// Characteristic. Die Empfangszeit nimmt schon der BLE-Task, die Antwort
+// geht als Notification auf derselben Characteristic zurück, die Sendezeit
+// setzt der BLE-TX-Task unmittelbar vor notify().
+void onTimeSyncWrite(const uint8_t* data, size_t len);
+
+// --- START ---
+// Zeitpunkte des letzten Starts als hal::micros(), 0 = noch nicht erreicht
+enum BootPhase : uint8_t {
+    BOOT_BEGIN,          // begin() aufgerufen
+    BOOT_INPUT_READY,    // Tasten-Interrupts an, Weck-Taste übernommen
+    BOOT_ADVERTISING,    // erstes Advertising gestartet
+    BOOT_DEFERRED_DONE,  // Flash-Log, Akkuwert, hal::bootDeferred() fertig
+    BOOT_PHASE_COUNT
+};
+
+uint32_t bootPhaseUs(BootPhase phase);
+
+// --- DIAGNOSE ---
+// Messpunkte je Tastendruck, jeweils gemessen ab der Flanke in der ISR
+enum LatencyStage : uint8_t {
+    STAGE_DEBOUNCED,   // Entprellung hat den Druck akzeptiert
+    STAGE_ENCODED,     // Paket ist kodiert
+    STAGE_NOTIFIED,    // notify() ist zurückgekehrt
+    STAGE_COUNT
+};
+
+// Inhalt der Diagnose-Characteristic (little endian):
+//   [0] DIAG_VERSION, [1] Anzahl Stufen
+//   je Stufe 5 x uint32 in µs: count, min, p50, p99, max
+//   je Verbindungsprofil (schnell, sparsam) 3 x uint16: angefragt, angenommen, abgelehnt
+//   uint16 aktuelles Intervall (x1.25 ms), uint16 Peripheral Latency
+//   Advertising: uint8 Anzahl Phasen, uint8 aktuelle Phase (0xFF = keine),
+//   uint32 ms vom Neustart der Phasen bis zur letzten Verbindung,
+//   je Phase (immer adv::MAX_PHASES) uint16 begonnen, uint16 verbunden, uint32 ms aktiv
+//   Start: je BootPhase uint32 µs (bootPhaseUs)
+//   uint32 Tastendrücke, die mangels Platz vor txQueue verloren gingen
+const uint8_t DIAG_VERSION = 5;
+const size_t DIAG_SIZE =
+    2 + STAGE_COUNT * 5 * 4 + 2 * 3 * 2 + 2 * 2 + 2 + 4 + adv::MAX_PHASES * 8 + BOOT_PHASE_COUNT * 4 + 4;
+
+size_t readDiagnostics(uint8_t* out, size_t maxLen);
+
+// Flanken-Queue ISR -> Eingabe: verworfen (Queue voll) und höchster Füllstand
+struct QueueStats {
+    uint32_t dropped;
+    uint32_t peak;
+    uint32_t capacity;
+};
+QueueStats buttonQueueStats();
+
+}  // namespace remote
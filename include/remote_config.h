@@ -0,0 +1,108 @@
+#pragma once
+#include <cstdint>
+#include "adv_scheduler.h"
+#include "button_scanner.h"
+#include "debouncer.h"
+#include "hid_macro.h"
+
+// --- KONFIGURATION ---
+#define DEVICE_NAME         "Remote-Switch"
+#define SERVICE_UUID        "12345678-1234-1234-1234-1234567890ab"
+#define CHAR_BUTTON_UUID    "12345678-1234-1234-1234-1234567890ac"
+#define CHAR_BATTERY_UUID   "12345678-1234-1234-1234-1234567890ad"
+#define CHAR_DIAG_UUID      "12345678-1234-1234-1234-1234567890ae"
+#define CHAR_MODE_UUID      "12345678-1234-1234-1234-1234567890af"
+#define CHAR_LOG_UUID       "12345678-1234-1234-1234-1234567890b0"
+#define CHAR_CONFIG_UUID    "12345678-1234-1234-1234-1234567890b1"
+#define CHAR_OTA_CTRL_UUID  "12345678-1234-1234-1234-1234567890b2"
+#define CHAR_OTA_DATA_UUID  "12345678-1234-1234-1234-1234567890b3"
+#define CHAR_TIME_SYNC_UUID "12345678-1234-1234-1234-1234567890b4"
+
+// PINS
+const int buttonNextPin = 25; 
+const int buttonPrevPin = 32; 
+const int batteryPin = 36; 
+const int ledPin = 2; // Blaue LED
+
+// Alle Tasten, Reihenfolge = ButtonId (1, 2, ...). Für Fußschalter / Clicker
+// mit mehr Tasten hier erweitern oder BUTTON_MATRIX setzen (z.B. per build_flags).
+// Eingänge (Taster bzw. Spalten) brauchen den internen Pull-up: GPIO 34-39
+// sind reine Eingänge ohne Pull-up und gehen nur mit externem Widerstand.
+// Deep Sleep: auf dem ESP32 wecken nur die ersten beiden Eingänge (ext0 und
+// ext1, das dort nur "alle LOW" kann), in der Matrix also nur Tasten an den
+// ersten beiden Spalten. ESP32-S2/S3 wecken mit jedem RTC-fähigen Eingang.
+#ifdef BUTTON_MATRIX
+constexpr scan::Matrix<2, 4> BUTTON_KEYS = {{26, 27}, {buttonNextPin, buttonPrevPin, 33, 4}};
+#else
+constexpr scan::PinSet<2> BUTTON_KEYS = {{buttonNextPin, buttonPrevPin}};
+#endif
+constexpr size_t BUTTON_COUNT = BUTTON_KEYS.size();
+
+// MEHRERE HOSTS: so viele Centrals gleichzeitig (Controller des ESP32 unter
+// Arduino: höchstens 3). Solange ein Platz frei ist, advertised das Gerät
+// neben den Verbindungen langsam weiter.
+const size_t MAX_CENTRALS = 3;
+const uint16_t ADV_INTERVAL_CONNECTED = 1600;   // x0.625 ms = 1 s
+
+// ADVERTISING ohne Verbindung (adv_scheduler.h): nach Trennung, Start und
+// Tastendruck erst schnell, dann immer seltener. Intervall x0.625 ms
+// (adv::STOP = aus bis zum nächsten Tastendruck), Dauer in s; die letzte
+// Phase läuft bis zur Verbindung bzw. zum Deep Sleep.
+constexpr adv::Phase ADV_PHASES[] = {
+    {32, 30},     // 20 ms: Host im Hintergrund-Scan findet das Gerät sofort
+    {244, 90},    // 152.5 ms
+    {1636, 0},    // 1022.5 ms
+};
+
+// EINSTELLUNGEN
+const int BATTERY_INTERVAL = 5000; 
+const uint32_t BATTERY_SAMPLE_INTERVAL = 250; // ein ADC-Wert pro Tick
+const uint32_t DEBOUNCE_MS = 20;      // Sperrzeit nach jeder akzeptierten Flanke (mindestens)
+// Entprellen je Taste (debouncer.h, Vergleich: `program bounce`). EAGER meldet
+// den Druck schon mit der ersten Flanke; INTEGRATOR / SHIFT warten 3 Ticks,
+// filtern dafür Störimpulse (lange Kabel, Fußschalter) heraus.
+constexpr scan::Strategy DEBOUNCE_STRATEGIES[] = {scan::DEBOUNCE_EAGER, scan::DEBOUNCE_EAGER};
+const uint32_t LED_BLINK_MS = 100;
+const uint32_t WAIT_HINT_INTERVAL = 3000;
+const uint32_t TRACE_RETRY_MS = 5;         // Log-Zeilen warten auf Platz im UART-Sendepuffer (trace_log.h)
+const uint32_t TX_RETRY_MS = 5;            // Notification vom Stack abgelehnt (keine Puffer), erneut versuchen
+const uint32_t SLEEP_TIMEOUT = 60000 * 5; // 5 Minuten Inaktivität bis Deep Sleep (0 = nie)
+const uint32_t REPLAY_MAX_AGE = 15000;     // ältere Drücke ohne Verbindung werden verworfen
+const uint32_t CONN_IDLE_AFTER = 10000;    // Ruhephase bis zum sparsamen Verbindungsintervall
+const uint32_t CONN_REQUEST_TIMEOUT = 3000; // ohne Antwort des Centrals gilt die Anfrage als abgelehnt
+const int8_t TX_POWER_DBM = 9;
+
+// Die Werte hier sind Standardwerte: die App kann sie über die
+// Konfigurations-Characteristic ändern (device_config.h, im NVS gespeichert).
+
+// GESTEN (gesture_engine.h): Belegung je Taste, 0 = nur Klick ohne Wartezeit.
+// Doppelklick und langer Druck verzögern den Klick bis zur Entscheidung.
+const uint8_t GESTURES_NEXT = 0;   // z.B. gesture::MAP_LONG | gesture::MAP_REPEAT
+const uint8_t GESTURES_PREV = 0;
+const bool GESTURE_CHORD = false;  // beide Tasten zusammen -> eigener Code
+
+// DAUERFEUER (MAP_REPEAT): nach REPEAT_DELAY_MS Halten die erste Wiederholung,
+// dann alle REPEAT_START_MS, über REPEAT_RAMP_MS immer schneller bis
+// REPEAT_MIN_MS. Mehrere fällige Seiten gehen als ein Eintrag mit Zähler raus.
+const uint16_t REPEAT_DELAY_MS = 500;   // zugleich Haltezeit für den langen Druck
+const uint16_t REPEAT_START_MS = 150;   // ~7 Seiten/s
+const uint16_t REPEAT_MIN_MS = 25;      // 40 Seiten/s
+const uint16_t REPEAT_RAMP_MS = 2000;
+
+// HID-MODUS: Makro je Code (Klick = ButtonId, Gesten siehe gesture_engine.h),
+// Syntax siehe hid_macro.h, z.B. "ctrl+pagedown, wait 30, enter".
+// Codes ohne Eintrag werden im HID-Modus ignoriert.
+constexpr hid::MacroSource HID_MACROS[] = {
+    {1, "ctrl+pagedown"},  // NEXT: OneNote nächste Seite
+    {2, "ctrl+pageup"},    // PREV: vorige Seite
+};
+
+const uint32_t MODE_RESTART_DELAY = 500;  // Schreib-Antwort rausgehen lassen, dann Neustart
+
+// EREIGNIS-LOG (flash_log.h): Ring aus LOG_SECTORS x 4 KiB am Anfang der
+// SPIFFS-Partition (wird sonst nicht benutzt), 340 Datensätze je Sektor
+const size_t LOG_SECTORS = 16;
+const size_t LOG_STAGE_RECORDS = 16;        // RAM-Puffer, voll -> ein Schreibvorgang
+const uint32_t LOG_FLUSH_INTERVAL = 60000;  // spätestens so lange nach dem ersten gepufferten Datensatz
+const uint32_t LOG_STREAM_TICK_MS = 10;     // Download: Blöcke nachschieben
+const size_t LOG_BLOCKS_PER_TICK = 4;
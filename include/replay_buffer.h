@@ -0,0 +1,43 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Tastendrücke, die ankommen, solange die Verbindung noch nicht bereit ist
+// (Aufwachen aus Deep Sleep, Verbindungsaufbau, Abonnement fehlt). Reines
+// POD ohne Konstruktor, damit es im RTC-Speicher liegen kann und den Deep
+// Sleep übersteht. Zeitstempel: hal::rtcMillis() der Flanke, die Uhr läuft
+// im Schlaf weiter. hal::micros() fängt nach dem Neustart neu an, beim
+// Nachliefern wird daraus wieder die Gerätezeit der Flanke fürs Paket.
+struct ReplayEntry {
+    uint32_t timeMs;
+    uint8_t code;
+};
+
+template <size_t N>
+struct ReplayBuffer {
+    ReplayEntry entries[N];
+    uint8_t count;
+    uint32_t dropped;   // wegen Überlauf oder Alter verworfen
+
+    // Bei vollem Puffer fällt der älteste Eintrag heraus
+    void add(uint8_t code, uint32_t timeMs) {
+        if (count >= N) {
+            for (size_t i = 1; i < N; i++) entries[i - 1] = entries[i];
+            count = N - 1;
+            dropped++;
+        }
+        entries[count++] = {timeMs, code};
+    }
+
+    void dropOlderThan(uint32_t nowMs, uint32_t maxAgeMs) {
+        size_t keep = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (nowMs - entries[i].timeMs <= maxAgeMs) entries[keep++] = entries[i];
+            else dropped++;
+        }
+        count = (uint8_t)keep;
+    }
+
+    bool empty() const { return count == 0; }
+    void clear() { count = 0; }
+};
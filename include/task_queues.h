@@ -0,0 +1,54 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "event_ring.h"
+#include "hal.h"
+
+// Übergaben zwischen den Firmware-Tasks aus remote.cpp. Jede Schlange ist ein
+// EventRing mit genau einem Producer und einem Consumer, ohne Locks:
+//
+//   Eingabe  --txQueue--------->  BLE-TX     Tasten-Pakete, HID-Reports, Akku, OTA-Status
+//   Haushalt --bulkQueue------->  BLE-TX     Blöcke des Log-Downloads
+//   Eingabe  --logQueue-------->  Haushalt   Datensätze für das Flash-Log
+//   Eingabe  --linkSnapshots--->  BLE-TX     Kopie der Link-Tabelle (link_table.h)
+//
+// Nur der BLE-TX-Task ruft hal::bleNotify() auf. Kein Heap, nur Header.
+namespace tasks {
+
+enum Priority : uint8_t {
+    PRIO_HOUSEKEEPING = 1,   // Akku, Flash-Log, serielle Ausgabe
+    PRIO_TX = 4,             // unter dem NimBLE-Host, damit er die Pakete abholt
+    PRIO_INPUT = 5,          // Tasten, Gesten, Verbindungszustand
+};
+
+// Ein Notify-Auftrag. edgeUs: Flanken-Zeitstempel der enthaltenen Drücke für
+// die Latenz-Stufe STAGE_NOTIFIED (weitere Drücke werden nicht gemessen).
+template <size_t CAP, size_t EDGES>
+struct TxItem {
+    hal::Characteristic ch;
+    uint8_t edgeCount;
+    uint16_t len;
+    uint32_t edgeUs[EDGES > 0 ? EDGES : 1];
+    uint8_t data[CAP];
+};
+
+// Sendet aus beiden Schlangen, bis sie leer sind oder send() ein Element
+// ablehnt; es bleibt dann vorne stehen und geht beim nächsten Mal zuerst
+// raus. urgent hat Vorrang: vor jedem Element aus bulk wird urgent geleert.
+// true, wenn beide leer sind.
+template <class U, size_t NU, class B, size_t NB, class Send>
+bool drain(EventRing<U, NU>& urgent, EventRing<B, NB>& bulk, Send send) {
+    U u;
+    B b;
+    for (;;) {
+        while (urgent.peek(u)) {
+            if (!send(u)) return false;
+            urgent.pop(u);
+        }
+        if (!bulk.peek(b)) return true;
+        if (!send(b)) return false;
+        bulk.pop(b);
+    }
+}
+
+}  // namespace tasks
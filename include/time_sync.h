@@ -0,0 +1,157 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Zeitabgleich Host <-> Gerät über CHAR_TIME_SYNC_UUID (little endian):
+//
+//   Host -> Gerät (Write Without Response), REQUEST_SIZE Bytes:
+//     [0]      Sequenznummer des Hosts
+//     [1..4]   t1: Host-Zeit beim Senden in µs, kommt unverändert zurück
+//   Gerät -> Host (Notification), REPLY_SIZE Bytes:
+//     [0..4]   wie die Anfrage
+//     [5..8]   t2: hal::micros() beim Empfang (BLE-Callback)
+//     [9..12]  t3: hal::micros() direkt vor notify() (BLE-TX-Task)
+//
+// Mit t4 = Host-Zeit beim Empfang der Antwort, wie bei NTP:
+//   Offset (Gerät - Host) = ((t2 - t1) + (t3 - t4)) / 2
+//   Umlaufzeit            = (t4 - t1) - (t3 - t2)
+// Der Offset stimmt bis auf die halbe Umlaufzeit, weil Hin- und Rückweg über
+// die Verbindungs-Events verschieden lang sein können. Estimator nimmt je
+// Runde nur die Antwort mit der kürzesten Umlaufzeit und legt durch diese
+// Punkte eine Gerade -> Offset und Drift der Geräteuhr. Damit rechnet der Host
+// die Gerätezeit aus den Tasten-Paketen (button_packet.h) in seine Zeit um.
+// Kein Heap, nur Header.
+namespace tsync {
+
+const size_t REQUEST_SIZE = 5;
+const size_t REPLY_SIZE = 13;
+
+inline void putU32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+inline uint32_t getU32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Antwort auf eine Anfrage, t3 setzt stampSend() erst beim Senden.
+// false bei falscher Länge.
+inline bool encodeReply(const uint8_t* request, size_t len, uint32_t receivedUs, uint8_t* out) {
+    if (len != REQUEST_SIZE) return false;
+    for (size_t i = 0; i < REQUEST_SIZE; i++) out[i] = request[i];
+    putU32(out + 5, receivedUs);
+    putU32(out + 9, 0);
+    return true;
+}
+
+inline void stampSend(uint8_t* reply, uint32_t sentUs) { putU32(reply + 9, sentUs); }
+
+// --- HOST-SEITE ---
+// Schätzt Offset und Drift aus Runden von Anfragen. Host-Zeiten in µs als
+// uint64, Gerätezeiten wie gesendet (uint32, läuft nach 71 min über; zwischen
+// zwei Runden dürfen höchstens 35 min liegen).
+class Estimator {
+public:
+    static const size_t MAX_POINTS = 16;   // älteste Runde fällt heraus
+
+    // Eine Antwort, t4 = Host-Zeit beim Empfang. false, wenn sie nicht passt.
+    bool add(const uint8_t* reply, size_t len, uint64_t t4) {
+        if (len != REPLY_SIZE) return false;
+        // t1 ist nur mit 32 Bit zurückgekommen -> relativ zu t4 zurückrechnen
+        const uint64_t t1 = t4 - (uint32_t)((uint32_t)t4 - getU32(reply + 1));
+        const int64_t t2 = unwrapDevice(getU32(reply + 5));
+        const int64_t t3 = t2 + (int32_t)(getU32(reply + 9) - getU32(reply + 5));
+        const int64_t rtt = (int64_t)(t4 - t1) - (t3 - t2);
+        if (t3 < t2 || rtt < 0) return false;
+        if (!haveBest_ || rtt < best_.rttUs) {
+            best_.hostUs = (int64_t)(t1 + (t4 - t1) / 2);
+            best_.offsetUs = ((double)(t2 - (int64_t)t1) + (double)(t3 - (int64_t)t4)) / 2;
+            best_.rttUs = (uint32_t)rtt;
+            haveBest_ = true;
+        }
+        deviceRef_ = t3;
+        haveDevice_ = true;
+        return true;
+    }
+
+    // Runde abschließen: die beste Antwort wird ein Punkt der Geraden
+    void endRound() {
+        if (!haveBest_) return;
+        if (count_ == MAX_POINTS) {
+            for (size_t i = 1; i < MAX_POINTS; i++) points_[i - 1] = points_[i];
+            count_--;
+        }
+        points_[count_++] = best_;
+        haveBest_ = false;
+        fit();
+    }
+
+    bool valid() const { return count_ > 0; }
+    size_t rounds() const { return count_; }
+
+    // Gerätezeit - Host-Zeit zum Host-Zeitpunkt hostUs
+    double offsetUs(uint64_t hostUs) const { return offset_ + drift_ * ((double)(int64_t)hostUs - originUs_); }
+    // Geht die Geräteuhr schneller als die des Hosts: positiv
+    double driftPpm() const { return drift_ * 1e6; }
+    // Fehlerschranke des Offsets: größte halbe Umlaufzeit der Punkte der Geraden
+    uint32_t errorBoundUs() const {
+        uint32_t rtt = 0;
+        for (size_t i = 0; i < count_; i++) rtt = points_[i].rttUs > rtt ? points_[i].rttUs : rtt;
+        return rtt / 2;
+    }
+
+    // Gerätezeit (hal::micros) -> Host-Zeit
+    uint64_t toHostUs(uint32_t deviceUs) const {
+        const double device = (double)unwrapNear(deviceUs) - originUs_;
+        return (uint64_t)(int64_t)(originUs_ + (device - offset_) / (1 + drift_) + 0.5);
+    }
+
+private:
+    struct Point {
+        int64_t hostUs;   // Mitte von t1 und t4
+        double offsetUs;
+        uint32_t rttUs;
+    };
+
+    int64_t unwrapNear(uint32_t deviceUs) const {
+        return haveDevice_ ? deviceRef_ + (int32_t)(deviceUs - (uint32_t)deviceRef_) : deviceUs;
+    }
+
+    int64_t unwrapDevice(uint32_t deviceUs) {
+        const int64_t v = unwrapNear(deviceUs);
+        deviceRef_ = v;
+        haveDevice_ = true;
+        return v;
+    }
+
+    // Kleinste Quadrate über alle Punkte, ein Punkt: nur Offset
+    void fit() {
+        originUs_ = (double)points_[0].hostUs;
+        double sx = 0, sy = 0, sxx = 0, sxy = 0;
+        for (size_t i = 0; i < count_; i++) {
+            const double x = (double)points_[i].hostUs - originUs_, y = points_[i].offsetUs;
+            sx += x;
+            sy += y;
+            sxx += x * x;
+            sxy += x * y;
+        }
+        const double n = (double)count_, den = n * sxx - sx * sx;
+        drift_ = count_ > 1 && den > 0 ? (n * sxy - sx * sy) / den : 0;
+        offset_ = (sy - drift_ * sx) / n;
+    }
+
+    Point points_[MAX_POINTS];
+    size_t count_ = 0;
+    Point best_ = {};
+    bool haveBest_ = false;
+    int64_t deviceRef_ = 0;
+    bool haveDevice_ = false;
+    double originUs_ = 0;
+    double offset_ = 0;
+    double drift_ = 0;
+};
+
+}  // namespace tsync
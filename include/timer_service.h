@@ -0,0 +1,139 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+typedef void (*TimerCallback)(void* arg);
+
+// Kooperativer Timer-Dienst ohne Heap: N feste Timer-Slots (IDs 0..N-1),
+// geordnet in einem indizierten Min-Heap nach Deadline. run() wird aus der
+// loop() aufgerufen und feuert alle fälligen Timer, timeUntilNext() sagt,
+// wie lange die loop() danach schlafen darf.
+// Zeiten in ms, Vergleiche sind überlauffest (millis() läuft nach 49 Tagen über).
+template <size_t N>
+class TimerService {
+public:
+    static constexpr uint32_t NO_DEADLINE = 0xFFFFFFFF;
+
+    TimerService() {
+        for (size_t i = 0; i < N; i++) pos_[i] = -1;
+    }
+
+    void startOnce(uint8_t id, uint32_t now, uint32_t delayMs, TimerCallback cb, void* arg = nullptr) {
+        start(id, now + delayMs, 0, cb, arg);
+    }
+
+    void startPeriodic(uint8_t id, uint32_t now, uint32_t periodMs, TimerCallback cb, void* arg = nullptr) {
+        start(id, now + periodMs, periodMs, cb, arg);
+    }
+
+    void cancel(uint8_t id) {
+        if (id >= N || pos_[id] < 0) return;
+        removeAt(pos_[id]);
+    }
+
+    bool isActive(uint8_t id) const { return id < N && pos_[id] >= 0; }
+
+    // Feuert alle Timer mit deadline <= now. Callbacks dürfen Timer neu
+    // starten oder stoppen, auch den eigenen.
+    void run(uint32_t now) {
+        while (count_ > 0 && !before(now, slots_[heap_[0]].deadline)) {
+            const uint8_t id = heap_[0];
+            Slot& s = slots_[id];
+            TimerCallback cb = s.cb;
+            void* arg = s.arg;
+            if (s.period > 0) {
+                // Periodisch: nächste Deadline relativ zur alten, damit kein Drift entsteht.
+                // Lag die loop() mehrere Perioden zurück, wird nicht nachgeholt.
+                s.deadline += s.period;
+                if (!before(now, s.deadline)) s.deadline = now + s.period;
+                siftDown(0);
+            } else {
+                removeAt(0);
+            }
+            cb(arg);
+        }
+    }
+
+    // ms bis zur nächsten Deadline (0 = sofort fällig), NO_DEADLINE wenn keiner läuft
+    uint32_t timeUntilNext(uint32_t now) const {
+        if (count_ == 0) return NO_DEADLINE;
+        const uint32_t deadline = slots_[heap_[0]].deadline;
+        return before(now, deadline) ? deadline - now : 0;
+    }
+
+private:
+    struct Slot {
+        uint32_t deadline = 0;
+        uint32_t period = 0;
+        TimerCallback cb = nullptr;
+        void* arg = nullptr;
+    };
+
+    static bool before(uint32_t a, uint32_t b) { return (int32_t)(a - b) < 0; }
+
+    void start(uint8_t id, uint32_t deadline, uint32_t period, TimerCallback cb, void* arg) {
+        if (id >= N) return;
+        Slot& s = slots_[id];
+        s.deadline = deadline;
+        s.period = period;
+        s.cb = cb;
+        s.arg = arg;
+        if (pos_[id] < 0) {
+            heap_[count_] = id;
+            pos_[id] = count_;
+            count_++;
+            siftUp(count_ - 1);
+        } else {
+            siftUp(pos_[id]);
+            siftDown(pos_[id]);
+        }
+    }
+
+    void removeAt(int i) {
+        const uint8_t id = heap_[i];
+        count_--;
+        pos_[id] = -1;
+        if (i == count_) return;
+        heap_[i] = heap_[count_];
+        pos_[heap_[i]] = i;
+        siftUp(i);
+        siftDown(i);
+    }
+
+    void swap(int a, int b) {
+        const uint8_t t = heap_[a];
+        heap_[a] = heap_[b];
+        heap_[b] = t;
+        pos_[heap_[a]] = a;
+        pos_[heap_[b]] = b;
+    }
+
+    bool less(int a, int b) const { return before(slots_[heap_[a]].deadline, slots_[heap_[b]].deadline); }
+
+    void siftUp(int i) {
+        while (i > 0) {
+            const int parent = (i - 1) / 2;
+            if (!less(i, parent)) break;
+            swap(i, parent);
+            i = parent;
+        }
+    }
+
+    void siftDown(int i) {
+        for (;;) {
+            const int l = 2 * i + 1;
+            const int r = l + 1;
+            int smallest = i;
+            if (l < count_ && less(l, smallest)) smallest = l;
+            if (r < count_ && less(r, smallest)) smallest = r;
+            if (smallest == i) break;
+            swap(i, smallest);
+            i = smallest;
+        }
+    }
+
+    Slot slots_[N];
+    uint8_t heap_[N];
+    int pos_[N];
+    int count_ = 0;
+};
@@ -0,0 +1,204 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "event_ring.h"
+#include "hal.h"
+#include "trace_messages.h"
+
+// Aufgeschobenes Logging: LOG(MSG_..., Werte) legt nur einen Binär-Datensatz
+// (Meldungs-ID, Zeit, bis zu MAX_ARGS Werte) in einen RAM-Ring, ohne
+// Formatieren, ohne Heap und ohne UART. Formatiert und ausgegeben wird erst
+// im Leerlauf der loop() mit flush(), und nur so viel, wie der Sendepuffer
+// ohne Warten aufnimmt.
+//
+// Meldungen oberhalb von LOG_LEVEL erzeugen keinen Code, ihre Argumente
+// werden nicht ausgewertet. Anzahl der Argumente und Format werden zur
+// Übersetzungszeit gegeneinander geprüft (auch bei abgeschalteten Meldungen).
+// Nur aus der loop() aufrufen (ein Producer), nicht aus ISRs oder dem BLE-Task.
+#define LOG_LEVEL_OFF 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#define LOG(id, ...)                                                                   \
+    do {                                                                               \
+        if constexpr (trace::enabled(trace::id)) trace::write<trace::id>(__VA_ARGS__); \
+    } while (0)
+
+namespace trace {
+
+enum Level : uint8_t {
+    LEVEL_ERROR = LOG_LEVEL_ERROR,
+    LEVEL_WARN = LOG_LEVEL_WARN,
+    LEVEL_INFO = LOG_LEVEL_INFO,
+    LEVEL_DEBUG = LOG_LEVEL_DEBUG,
+};
+
+enum MessageId : uint16_t {
+#define TRACE_ID(id, level, format) id,
+    TRACE_MESSAGES(TRACE_ID)
+#undef TRACE_ID
+    MSG_COUNT
+};
+
+struct Message {
+    Level level;
+    const char* format;
+};
+
+constexpr Message MESSAGES[MSG_COUNT] = {
+#define TRACE_ENTRY(id, level, format) {LEVEL_##level, format},
+    TRACE_MESSAGES(TRACE_ENTRY)
+#undef TRACE_ENTRY
+};
+
+constexpr bool enabled(MessageId id) { return MESSAGES[id].level <= LOG_LEVEL; }
+
+// Platzhalter im Format (%% zählt nicht)
+constexpr size_t argCount(const char* f) {
+    size_t n = 0;
+    for (; *f; f++) {
+        if (*f != '%') continue;
+        if (f[1] == '%') f++;
+        else n++;
+    }
+    return n;
+}
+
+const size_t MAX_ARGS = 3;
+const size_t RING_SIZE = 64;
+const size_t MAX_LINE = 96;   // längere Zeilen werden gekürzt
+
+struct Record {
+    uint32_t timeMs;
+    uint16_t id;
+    uint8_t argc;
+    uintptr_t args[MAX_ARGS];   // Zahlen oder Zeiger auf String-Literale
+};
+
+inline EventRing<Record, RING_SIZE> ring;
+inline uint32_t dropsReported = 0;
+
+template <MessageId ID, class... Args>
+inline void write(Args... args) {
+    static_assert(sizeof...(Args) == argCount(MESSAGES[ID].format), "Argumente passen nicht zum Format");
+    static_assert(sizeof...(Args) <= MAX_ARGS, "zu viele Argumente");
+    Record r;
+    r.timeMs = hal::millis();
+    r.id = ID;
+    r.argc = sizeof...(Args);
+    const uintptr_t values[] = {(uintptr_t)args..., 0};
+    for (size_t i = 0; i < sizeof...(Args); i++) r.args[i] = values[i];
+    ring.push(r);
+}
+
+// --- Ausgabe (Leerlauf) ---
+class LineWriter {
+public:
+    LineWriter(char* out, size_t cap) : out_(out), cap_(cap) {}
+
+    void put(char c) {
+        if (len_ + 1 < cap_) out_[len_++] = c;
+    }
+
+    void text(const char* s) {
+        while (*s) put(*s++);
+    }
+
+    void number(uintptr_t v, unsigned base, unsigned width, char pad) {
+        char digits[24];
+        unsigned n = 0;
+        do {
+            const unsigned d = (unsigned)(v % base);
+            digits[n++] = (char)(d < 10 ? '0' + d : 'a' + d - 10);
+            v /= base;
+        } while (v);
+        while (width > n) {
+            put(pad);
+            width--;
+        }
+        while (n) put(digits[--n]);
+    }
+
+    size_t finish() {
+        out_[len_] = '\0';
+        return len_;
+    }
+
+private:
+    char* out_;
+    size_t cap_;
+    size_t len_ = 0;
+};
+
+// Datensatz als Zeile "[Zeit ms] Meldung\n", Rückgabe: Länge ohne Nullbyte
+inline size_t format(const Record& r, char* out, size_t cap) {
+    LineWriter w(out, cap);
+    w.put('[');
+    w.number(r.timeMs, 10, 8, ' ');
+    w.text(" ms] ");
+    const char* f = r.id < MSG_COUNT ? MESSAGES[r.id].format : "?";
+    size_t arg = 0;
+    for (; *f; f++) {
+        if (*f != '%') {
+            w.put(*f);
+            continue;
+        }
+        f++;
+        if (*f == '%') {
+            w.put('%');
+            continue;
+        }
+        const char pad = *f == '0' ? '0' : ' ';
+        unsigned width = 0;
+        while (*f >= '0' && *f <= '9') width = width * 10 + (*f++ - '0');
+        const uintptr_t v = arg < r.argc ? r.args[arg] : 0;
+        arg++;
+        switch (*f) {
+        case 'd':
+            if ((intptr_t)v < 0) {
+                w.put('-');
+                w.number((uintptr_t)-(intptr_t)v, 10, width, pad);
+            } else {
+                w.number(v, 10, width, pad);
+            }
+            break;
+        case 'x': w.number(v, 16, width, pad); break;
+        case 's': w.text(v ? (const char*)v : "(null)"); break;
+        case '\0': return w.finish();
+        default: w.number(v, 10, width, pad); break;
+        }
+    }
+    w.put('\n');
+    return w.finish();
+}
+
+// Formatiert Datensätze und gibt sie an sink(line, len), bis der Ring leer
+// ist oder sink ablehnt (Sendepuffer voll, der Datensatz bleibt im Ring).
+// Verworfene Meldungen (Ring war voll) werden als eigene Zeile gemeldet.
+// true, wenn alles ausgegeben ist.
+template <class Sink>
+inline bool flush(Sink sink) {
+    char line[MAX_LINE];
+    const uint32_t dropped = ring.dropped();
+    if (dropped != dropsReported) {
+        Record r = {hal::millis(), MSG_DROPPED, 1, {dropped - dropsReported}};
+        if (!sink(line, format(r, line, sizeof(line)))) return false;
+        dropsReported = dropped;
+    }
+    Record r;
+    while (ring.peek(r)) {
+        if (!sink(line, format(r, line, sizeof(line)))) return false;
+        ring.pop(r);
+    }
+    return true;
+}
+
+inline bool pending() { return !ring.empty(); }
+
+}  // namespace trace
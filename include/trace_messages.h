@@ -0,0 +1,36 @@
+#pragma once
+
+// Alle Log-Meldungen der Firmware: ID, Stufe, Format (trace_log.h).
+// Formate: %u %d %x (mit Breite/0 wie printf, z.B. %02x), %s nur für
+// String-Literale, %% für das Prozentzeichen. Neue Meldungen hinten anfügen,
+// damit die IDs älterer Mitschnitte gültig bleiben.
+#define TRACE_MESSAGES(X)                                                                  \
+    X(MSG_MODE, INFO, "Modus: %s")                                                        \
+    X(MSG_CONFIG_INVALID, ERROR, "Konfiguration ungültig, nutze Standardwerte")           \
+    X(MSG_MACROS_INVALID, ERROR, "HID: Makros fehlerhaft")                                \
+    X(MSG_LOG_NO_FLASH, ERROR, "Log: kein Flash-Bereich")                                 \
+    X(MSG_WAKE_BUTTON, INFO, "Aufgewacht durch Taste %u -> Merke Aktion!")                \
+    X(MSG_CENTRALS, INFO, "Centrals: %u verbunden")                                       \
+    X(MSG_LINK_FOUND, WARN, "LOOP-CHECK: Verbindung erkannt!")                            \
+    X(MSG_LINK_LOST, WARN, "LOOP-CHECK: Verbindung verloren.")                            \
+    X(MSG_CONN_REQUEST, DEBUG, "Fordere Verbindungsintervall %u-%u an")                   \
+    X(MSG_CONN_PARAMS, DEBUG, "Verbindungsintervall %u (x1.25 ms), Latency %u")           \
+    X(MSG_MODE_CHANGED, INFO, "Modus gewechselt, Neustart")                               \
+    X(MSG_CONFIG_APPLIED, INFO, "Konfiguration übernommen (%u Bytes)")                    \
+    X(MSG_CONFIG_REJECTED, WARN, "Konfiguration abgelehnt (Fehler %u)")                   \
+    X(MSG_REPLAY, INFO, "Verbindung steht! Sende %u gemerkte Drücke")                     \
+    X(MSG_BUTTON, DEBUG, "Taste %u, Code 0x%02x")                                         \
+    X(MSG_MACRO_UNMAPPED, WARN, "HID: Code 0x%02x nicht belegt")                          \
+    X(MSG_DEEP_SLEEP, INFO, "Gute Nacht! Gehe in Deep Sleep.")                            \
+    X(MSG_WAITING, DEBUG, "... warte auf App ...")                                        \
+    X(MSG_ADV_PHASE, DEBUG, "Advertising: Phase %u")                                      \
+    X(MSG_LOG_SENT, INFO, "Log: %u Datensätze in %u Blöcken gesendet")                    \
+    X(MSG_OTA_BEGIN, INFO, "OTA: %u Bytes, ab Offset %u")                                 \
+    X(MSG_OTA_DONE, INFO, "OTA: Image geprüft, Neustart")                                 \
+    X(MSG_OTA_ERROR, ERROR, "OTA: Fehler %u")                                             \
+    X(MSG_DROPPED, WARN, "Log: %u Meldungen verworfen (Ring voll)")                      \
+    X(MSG_READY, INFO, "ESP32 Bereit. Warte auf Verbindung...")                           \
+    X(MSG_BATTERY, DEBUG, "Sende Akku: %u%%")                                            \
+    X(MSG_BOOT_TIMES, INFO, "Start: Advertising nach %u µs, fertig nach %u µs")           \
+    X(MSG_LINK_RESYNC, WARN, "Link-Ereignisse verloren, %u Centrals vom Stack übernommen") \
+    X(MSG_MACRO_QUEUE_FULL, WARN, "HID: Makro-Schlange voll, Code 0x%02x verworfen")
@@ -3,11 +3,15 @@ import threading
 import tkinter as tk
 from tkinter import ttk, messagebox, simpledialog 
 import json
+import csv
+import hashlib
+import struct
 import os
 import sys
 import time
 import winreg 
 import shutil
+import zlib
 from bleak import BleakScanner, BleakClient
 import keyboard
 import pystray
@@ -26,6 +30,127 @@ except ImportError:
 SERVICE_UUID = "12345678-1234-1234-1234-1234567890ab"
 CHAR_BUTTON_UUID = "12345678-1234-1234-1234-1234567890ac"
 CHAR_BATTERY_UUID = "12345678-1234-1234-1234-1234567890ad"
+CHAR_MODE_UUID = "12345678-1234-1234-1234-1234567890af"
+CHAR_LOG_UUID = "12345678-1234-1234-1234-1234567890b0"
+CHAR_CONFIG_UUID = "12345678-1234-1234-1234-1234567890b1"
+CHAR_OTA_CTRL_UUID = "12345678-1234-1234-1234-1234567890b2"
+CHAR_OTA_DATA_UUID = "12345678-1234-1234-1234-1234567890b3"
+CHAR_TIME_SYNC_UUID = "12345678-1234-1234-1234-1234567890b4"
+
+# Gerätemodus (siehe include/remote.h): Bridge über diese App oder direkt als HID-Tastatur
+DEVICE_MODES = {"bridge": 0, "hid": 1}
+
+# Button-Paket (siehe include/button_packet.h). Ab Version 2 steht im Kopf die
+# Gerätezeit (µs) der ersten Flanke, Version 1 (ms beim Kodieren) geht weiter
+PACKET_VERSION = 2
+PACKET_VERSIONS = (1, 2)
+PACKET_HEADER_SIZE = 8
+
+# Zeitabgleich (siehe include/time_sync.h): Runden zu SYNC_EXCHANGES Anfragen
+SYNC_EXCHANGES = 16
+SYNC_INTERVAL_S = 30
+SYNC_MAX_POINTS = 16
+
+# Gesten im oberen Nibble des Codes (siehe include/gesture_engine.h)
+GESTURE_REPEAT = 3
+GESTURE_CHORD = 4
+GESTURE_KEYS = {0: "action", 1: "long", 2: "double", GESTURE_REPEAT: "repeat"}
+
+# Ereignis-Log (siehe include/flash_log.h und include/remote.h)
+LOG_CMD_DOWNLOAD = 1
+LOG_END_BLOCK = 0xFFFF
+LOG_RECORD = struct.Struct("<IBBBBbBH")  # timeMs, event, arg, battery, conn, rssi, reserviert, crc
+LOG_EVENTS = {1: "boot", 2: "press", 3: "connect", 4: "disconnect", 5: "deep_sleep", 6: "mode", 7: "replay_dropped",
+              8: "ota"}
+LOG_CONN_STATES = {0: "getrennt", 1: "verbunden", 2: "bereit"}
+
+# Geräte-Einstellungen als TLV-Blob (siehe include/device_config.h): Schlüssel in
+# "device_settings" -> (Typ, struct-Format); Text-Felder ohne Format
+CONFIG_VERSION = 1
+CONFIG_FIELDS = {
+    "debounce_ms": (1, "<H"),
+    "battery_interval_ms": (2, "<I"),
+    "led_blink_ms": (3, "<H"),
+    "sleep_timeout_ms": (4, "<I"),
+    "tx_power_dbm": (5, "<b"),
+    "name": (6, None),
+}
+CONFIG_GESTURE = 7
+CONFIG_CHORD = 8
+CONFIG_MACRO = 9
+CONFIG_ADV_PHASE = 10  # "advertising": [[Intervall ms, Dauer s], ...], Intervall 0 = aus
+CONFIG_DEBOUNCE_STRATEGY = 11  # "debounce": {"1": "integrator"}, Werte wie scan::Strategy
+DEBOUNCE_STRATEGIES = {"eager": 0, "integrator": 1, "shift": 2}
+CONFIG_REPEAT = 12  # "repeat": [Verzögerung ms, Start-Abstand ms, kleinster Abstand ms, Rampe ms]
+CONFIG_ERRORS = {1: "Version", 2: "abgeschnitten", 3: "Länge", 4: "Wertebereich", 5: "zu viele Makros",
+                 6: "Makro fehlerhaft", 7: "NVS", 8: "beschäftigt"}
+
+# Firmware-Update (siehe include/ota_receiver.h)
+OTA_CMD_BEGIN, OTA_CMD_FINISH = 1, 2
+OTA_READY, OTA_PROGRESS, OTA_RESEND, OTA_DONE = 1, 2, 3, 4
+OTA_ERRORS = {5: "Image zu groß", 6: "falscher Zustand", 7: "Flash-Fehler", 8: "Prüfsumme falsch",
+              9: "Signatur ungültig"}
+OTA_WINDOW = 2 * 4096
+OTA_CHUNK_OVERHEAD = 8
+OTA_MAX_SIGNATURE = 72   # ECDSA P-256 in DER (firmware.bin.sig)
+
+
+class ClockSync:
+    """Offset und Drift der Geräteuhr wie tsync::Estimator in include/time_sync.h:
+    je Runde die Antwort mit der kürzesten Umlaufzeit, durch diese Punkte eine Gerade."""
+
+    def __init__(self):
+        self.points = []  # (Host-Zeit µs, Offset Gerät - Host µs, Umlaufzeit µs)
+        self.best = None
+        self.device_ref = None
+        self.origin = self.offset = self.drift = 0.0
+
+    @staticmethod
+    def now_us():
+        return time.perf_counter_ns() // 1000
+
+    def unwrap(self, device_us):
+        if self.device_ref is None:
+            return device_us
+        return self.device_ref + ((device_us - self.device_ref + 0x80000000) & 0xFFFFFFFF) - 0x80000000
+
+    def add(self, reply, t4):
+        if len(reply) != 13:
+            return False
+        _, t1, rx, tx = struct.unpack("<BIII", reply)
+        t1 = t4 - ((t4 - t1) & 0xFFFFFFFF)
+        t2 = self.unwrap(rx)
+        t3 = t2 + ((tx - rx) & 0xFFFFFFFF)
+        self.device_ref = t3
+        rtt = (t4 - t1) - (t3 - t2)
+        if rtt < 0:
+            return False
+        if self.best is None or rtt < self.best[2]:
+            self.best = ((t1 + t4) / 2, ((t2 - t1) + (t3 - t4)) / 2, rtt)
+        return True
+
+    def end_round(self):
+        if self.best is None:
+            return
+        self.points = (self.points + [self.best])[-SYNC_MAX_POINTS:]
+        self.best = None
+        self.origin = self.points[0][0]
+        xs = [p[0] - self.origin for p in self.points]
+        ys = [p[1] for p in self.points]
+        n = len(xs)
+        den = n * sum(x * x for x in xs) - sum(xs) ** 2
+        self.drift = (n * sum(x * y for x, y in zip(xs, ys)) - sum(xs) * sum(ys)) / den if n > 1 and den > 0 else 0.0
+        self.offset = (sum(ys) - self.drift * sum(xs)) / n
+
+    def valid(self):
+        return bool(self.points)
+
+    def error_bound_us(self):
+        return max(p[2] for p in self.points) / 2 if self.points else 0
+
+    def to_host_us(self, device_us):
+        return self.origin + (self.unwrap(device_us) - self.origin - self.offset) / (1 + self.drift)
+
 
 # Config Datei liegt immer im gleichen Ordner wie die Exe/Script
 if getattr(sys, 'frozen', False):
@@ -39,6 +164,9 @@ else:
     BUNDLE_DIR = APP_DIR
 
 CONFIG_FILE = os.path.join(APP_DIR, "remote_config.json")
+EVENT_LOG_FILE = os.path.join(APP_DIR, "event_log.csv")
+FIRMWARE_FILE = os.path.join(APP_DIR, "firmware.bin")
+FIRMWARE_SIG_FILE = FIRMWARE_FILE + ".sig"
 
 # Extrahiere Icon beim ersten Start (nur bei EXE)
 def extract_icon():
@@ -72,6 +200,8 @@ class BluetoothRemoteApp:
         self.connected = False
         self.battery_level = 0
         self.startup_delay = startup_delay
+        self.last_seq = None
+        self.clock = ClockSync()
         self.tray_icon = None
         
         # Fenster-Protokoll für Schließen (verstecken statt beenden)
@@ -81,7 +211,20 @@ class BluetoothRemoteApp:
         self.config = {
             "api_key": "",
             "btn1_action": "pagedown", 
-            "btn2_action": "pageup"    
+            "btn2_action": "pageup",
+            # Gesten (müssen auch in der Firmware belegt sein, remote_config.h);
+            # leer = Geste ignorieren, Dauerfeuer fällt auf die Klick-Aktion zurück
+            "btn1_long": "", "btn1_double": "", "btn1_repeat": "",
+            "btn2_long": "", "btn2_double": "", "btn2_repeat": "",
+            "chord_action": "",
+            # "hid" = Gerät tippt selbst (HID_MACROS in remote_config.h), schneller, nicht umbelegbar
+            "device_mode": "bridge",
+            # Firmware-Einstellungen, leer = Standardwerte aus remote_config.h. Z.B.
+            # {"debounce_ms": 30, "name": "Lab-Pedal", "gestures": {"1": 1}, "chord": true,
+            #  "macros": {"1": "ctrl+pagedown"}, "debounce": {"1": "integrator"},
+            #  "repeat": [500, 150, 25, 2000]};
+            # der Name gilt nach dem nächsten Neustart
+            "device_settings": {}
         }
         self.load_config()
         
@@ -321,7 +464,8 @@ class BluetoothRemoteApp:
         while True:
             self.update_status("Scanne nach Remote-Switch...", "orange")
             try:
-                device = await BleakScanner.find_device_by_name("Remote-Switch", timeout=5.0) # type: ignore
+                name = self.config.get("device_settings", {}).get("name", "Remote-Switch")
+                device = await BleakScanner.find_device_by_name(name, timeout=5.0) # type: ignore
                 
                 if device:
                     self.update_status(f"Gefunden! Verbinde...", "blue")
@@ -330,6 +474,12 @@ class BluetoothRemoteApp:
                             self.client = client
                             self.connected = True
                             self.update_status("✅ Verbunden & Bereit", "green")
+                            self.last_seq = None
+                            self.clock = ClockSync()
+
+                            if await self.sync_device_mode(client):
+                                continue
+                            await self.sync_device_settings(client)
                             
                             await client.start_notify(CHAR_BUTTON_UUID, self.notification_handler)
                             try:
@@ -337,7 +487,11 @@ class BluetoothRemoteApp:
                             except Exception:
                                 pass
 
+                            next_sync = 0
                             while client.is_connected:
+                                if time.monotonic() >= next_sync:
+                                    next_sync = time.monotonic() + SYNC_INTERVAL_S
+                                    await self.sync_clock(client)
                                 await asyncio.sleep(1)
                     except Exception as e:
                         print(f"Connection Error: {e}")
@@ -348,19 +502,241 @@ class BluetoothRemoteApp:
                 print(f"Scan Error: {e}")
                 await asyncio.sleep(2)
 
+    async def sync_device_mode(self, client):
+        """Schreibt den gewünschten Modus ins Gerät. True, wenn es dafür neu startet."""
+        wanted = DEVICE_MODES.get(self.config.get("device_mode", "bridge"), 0)
+        try:
+            current = await client.read_gatt_char(CHAR_MODE_UUID)
+        except Exception:
+            return False  # alte Firmware ohne Modus-Characteristic
+        if current and current[0] == wanted:
+            return False
+        await client.write_gatt_char(CHAR_MODE_UUID, bytes([wanted]), response=True)
+        self.update_status("Modus gewechselt, Gerät startet neu...", "orange")
+        return True
+
+    def build_settings_blob(self):
+        settings = self.config.get("device_settings", {})
+        blob = bytearray([CONFIG_VERSION])
+
+        def put(type_id, value):
+            blob.extend((type_id, len(value)))
+            blob.extend(value)
+
+        for key, (type_id, fmt) in CONFIG_FIELDS.items():
+            if key in settings:
+                value = settings[key]
+                put(type_id, value.encode("ascii") if fmt is None else struct.pack(fmt, value))
+        for button, bits in settings.get("gestures", {}).items():
+            put(CONFIG_GESTURE, bytes([int(button), int(bits)]))
+        for button, strategy in settings.get("debounce", {}).items():
+            put(CONFIG_DEBOUNCE_STRATEGY, bytes([int(button), DEBOUNCE_STRATEGIES[strategy]]))
+        if "repeat" in settings:
+            put(CONFIG_REPEAT, struct.pack("<HHHH", *settings["repeat"]))
+        if "chord" in settings:
+            put(CONFIG_CHORD, bytes([1 if settings["chord"] else 0]))
+        for code, keys in settings.get("macros", {}).items():
+            put(CONFIG_MACRO, bytes([int(code, 0)]) + keys.encode("ascii"))
+        for interval_ms, seconds in settings.get("advertising", []):
+            put(CONFIG_ADV_PHASE, struct.pack("<HH", round(interval_ms / 0.625), seconds))
+        return bytes(blob)
+
+    async def sync_device_settings(self, client):
+        """Schreibt die Einstellungen ins Gerät, wenn sie sich vom gespeicherten Blob unterscheiden."""
+        try:
+            blob = self.build_settings_blob()
+            current = await client.read_gatt_char(CHAR_CONFIG_UUID)
+        except (ValueError, UnicodeError, struct.error) as e:
+            print(f"device_settings ungültig: {e}")
+            return
+        except Exception:
+            return  # alte Firmware ohne Konfigurations-Characteristic
+        stored = bytes(current[1:]) or bytes([CONFIG_VERSION])
+        if stored == blob:
+            return
+        await client.write_gatt_char(CHAR_CONFIG_UUID, blob, response=True)
+        await asyncio.sleep(0.2)
+        status = (await client.read_gatt_char(CHAR_CONFIG_UUID))[0]
+        if status:
+            print(f"Gerät lehnt device_settings ab: {CONFIG_ERRORS.get(status, status)}")
+
+    async def sync_clock(self, client):
+        """Eine Runde Zeitabgleich, Anfragen nacheinander, jede wartet auf ihre Antwort."""
+        replies = asyncio.Queue()
+
+        def on_reply(sender, data):
+            replies.put_nowait((ClockSync.now_us(), bytes(data)))
+
+        try:
+            await client.start_notify(CHAR_TIME_SYNC_UUID, on_reply)
+        except Exception:
+            return  # alte Firmware ohne Zeitabgleich
+        try:
+            for seq in range(SYNC_EXCHANGES):
+                t1 = ClockSync.now_us()
+                await client.write_gatt_char(CHAR_TIME_SYNC_UUID, struct.pack("<BI", seq, t1 & 0xFFFFFFFF),
+                                             response=False)
+                try:
+                    t4, data = await asyncio.wait_for(replies.get(), timeout=0.5)
+                except asyncio.TimeoutError:
+                    continue
+                if data[0] == seq:
+                    self.clock.add(data, t4)
+        finally:
+            await client.stop_notify(CHAR_TIME_SYNC_UUID)
+        self.clock.end_round()
+
+    async def download_event_log(self, client):
+        """Holt das Ereignis-Log als Notifications (Blöcke ganzer Datensätze) und speichert es als CSV."""
+        records, done = [], asyncio.Event()
+
+        def on_block(sender, data):
+            block = int.from_bytes(data[0:2], byteorder="little")
+            if block == LOG_END_BLOCK:
+                done.set()
+                return
+            for off in range(2, len(data) - LOG_RECORD.size + 1, LOG_RECORD.size):
+                records.append(LOG_RECORD.unpack_from(data, off))
+
+        await client.start_notify(CHAR_LOG_UUID, on_block)
+        try:
+            await client.write_gatt_char(CHAR_LOG_UUID, bytes([LOG_CMD_DOWNLOAD]), response=True)
+            await asyncio.wait_for(done.wait(), timeout=60)
+        finally:
+            await client.stop_notify(CHAR_LOG_UUID)
+
+        with open(EVENT_LOG_FILE, "w", newline="") as f:
+            writer = csv.writer(f, delimiter=";")
+            writer.writerow(["zeit_ms", "ereignis", "arg", "akku_prozent", "verbindung", "rssi_dbm"])
+            for time_ms, event, arg, battery, conn, rssi, _, _ in records:
+                writer.writerow([time_ms, LOG_EVENTS.get(event, event), arg, battery, LOG_CONN_STATES.get(conn, conn), rssi])
+        self.update_status(f"Log gespeichert: {len(records)} Einträge", "green")
+
+    def save_event_log(self, icon=None, item=None):
+        if not self.client or not self.connected:
+            self.update_status("Log: nicht verbunden", "red")
+            return
+        future = asyncio.run_coroutine_threadsafe(self.download_event_log(self.client), self.loop)
+        future.add_done_callback(lambda f: f.exception() and print(f"Log Error: {f.exception()}"))
+
+    async def update_firmware(self, client, image, signature):
+        """Streamt das Image im Fenster von zwei Blöcken. Nach einem Abbruch setzt
+        ein erneuter Aufruf mit demselben Image beim letzten geschriebenen Block fort.
+        Das erste Schreiben auf die OTA-Characteristics löst das Pairing aus."""
+        state = {"send": None, "ack": 0, "result": None}
+        changed = asyncio.Event()
+
+        def on_status(sender, data):
+            status, offset = data[0], int.from_bytes(data[1:5], byteorder="little")
+            if status == OTA_READY:
+                state["send"] = state["ack"] = offset
+            elif status == OTA_PROGRESS:
+                state["ack"] = max(state["ack"], offset)
+            elif status == OTA_RESEND:
+                state["send"] = offset
+            else:
+                state["result"] = status
+            changed.set()
+
+        await client.start_notify(CHAR_OTA_CTRL_UUID, on_status)
+        try:
+            begin = struct.pack("<BI", OTA_CMD_BEGIN, len(image)) + hashlib.sha256(image).digest() + signature
+            await client.write_gatt_char(CHAR_OTA_CTRL_UUID, begin, response=True)
+            payload = client.mtu_size - 3 - OTA_CHUNK_OVERHEAD
+            finish_sent = False
+            while state["result"] is None:
+                off = state["send"]
+                room = 0 if off is None else min(payload, len(image) - off, state["ack"] + OTA_WINDOW - off)
+                if room <= 0:
+                    if off == len(image) and state["ack"] == len(image) and not finish_sent:
+                        finish_sent = True
+                        await client.write_gatt_char(CHAR_OTA_CTRL_UUID, bytes([OTA_CMD_FINISH]), response=True)
+                    changed.clear()
+                    await asyncio.wait_for(changed.wait(), timeout=15)
+                    continue
+                data = image[off:off + room]
+                state["send"] = off + room
+                chunk = struct.pack("<I", off) + data + struct.pack("<I", zlib.crc32(data))
+                await client.write_gatt_char(CHAR_OTA_DATA_UUID, chunk, response=False)
+                self.update_status(f"Firmware: {state['ack'] * 100 // len(image)} %", "blue")
+        finally:
+            await client.stop_notify(CHAR_OTA_CTRL_UUID)
+        if state["result"] == OTA_DONE:
+            self.update_status("Firmware aktualisiert, Gerät startet neu", "green")
+        else:
+            self.update_status(f"Firmware-Fehler: {OTA_ERRORS.get(state['result'], state['result'])}", "red")
+
+    def start_firmware_update(self, icon=None, item=None):
+        if not self.client or not self.connected:
+            self.update_status("Firmware: nicht verbunden", "red")
+            return
+        if not os.path.exists(FIRMWARE_FILE):
+            self.update_status("firmware.bin fehlt neben der App", "red")
+            return
+        if not os.path.exists(FIRMWARE_SIG_FILE):
+            self.update_status("firmware.bin.sig fehlt (Signatur, siehe README)", "red")
+            return
+        with open(FIRMWARE_FILE, "rb") as f:
+            image = f.read()
+        with open(FIRMWARE_SIG_FILE, "rb") as f:
+            signature = f.read()
+        if not signature or signature[0] != 0x30 or len(signature) > OTA_MAX_SIGNATURE:
+            self.update_status("firmware.bin.sig ist keine ECDSA-Signatur", "red")
+            return
+        future = asyncio.run_coroutine_threadsafe(self.update_firmware(self.client, image, signature), self.loop)
+        future.add_done_callback(lambda f: f.exception() and print(f"OTA Error: {f.exception()}"))
+
     def on_disconnect(self, client):
         self.connected = False
         self.update_status("Verbindung verloren.", "red")
 
+    def decode_button_packet(self, data):
+        """Liefert eine Liste von (code, wiederholungen). Alte Firmware sendet nur 1 Byte."""
+        if len(data) == 1:
+            return [(data[0], 1)]
+        if len(data) < PACKET_HEADER_SIZE or data[0] not in PACKET_VERSIONS:
+            print(f"Unbekanntes Paket: {bytes(data).hex()}")
+            return []
+        count = data[1]
+        if len(data) != PACKET_HEADER_SIZE + 2 * count:
+            print(f"Paket mit falscher Länge: {bytes(data).hex()}")
+            return []
+        seq = int.from_bytes(data[2:4], byteorder="little")
+        if self.last_seq is not None:
+            lost = (seq - self.last_seq - 1) & 0xFFFF
+            if lost:
+                print(f"WARNUNG: {lost} Paket(e) verloren")
+        self.last_seq = seq
+        if data[0] >= 2 and self.clock.valid():
+            # Flanke am Gerät bis Empfang hier, Fehler höchstens die Schranke
+            device_us = int.from_bytes(data[4:8], byteorder="little")
+            latency_ms = (ClockSync.now_us() - self.clock.to_host_us(device_us)) / 1000
+            print(f"Latenz Taste -> PC: {latency_ms:.1f} ms (±{self.clock.error_bound_us() / 1000:.1f} ms)")
+        body = data[PACKET_HEADER_SIZE:]
+        return [(body[i], body[i + 1]) for i in range(0, len(body), 2)]
+
+    def action_for_code(self, code):
+        """Code aus dem Paket: unteres Nibble Taste, oberes Nibble Geste."""
+        button, gesture = code & 0x0F, code >> 4
+        if gesture == GESTURE_CHORD:
+            return self.config.get("chord_action", "")
+        # Weitere Tasten (Fußschalter, Clicker) über btn3_action, btn4_action, ...
+        if button == 0 or gesture not in GESTURE_KEYS:
+            return ""
+        action = self.config.get(f"btn{button}_{GESTURE_KEYS[gesture]}", "")
+        if not action and gesture == GESTURE_REPEAT:
+            action = self.config.get(f"btn{button}_action", "")
+        return action
+
     def notification_handler(self, sender, data):
         try:
-            val = int.from_bytes(data, byteorder="little")
-            action = ""
-            if val == 1: action = self.config["btn1_action"]
-            elif val == 2: action = self.config["btn2_action"]
-                
-            print(f"Trigger: {action}")
-            if action: keyboard.send(action)
+            for val, repeat in self.decode_button_packet(data):
+                action = self.action_for_code(val)
+
+                print(f"Trigger: {action} x{repeat}")
+                if action:
+                    for _ in range(repeat):
+                        keyboard.send(action)
         except Exception as e:
             print(f"Key Error: {e}")
 
@@ -393,6 +769,8 @@ class BluetoothRemoteApp:
             # Tray Menu
             menu = pystray.Menu(
                 pystray.MenuItem("Einstellungen öffnen", self.show_window, default=True),  # Default = Doppelklick
+                pystray.MenuItem("Ereignis-Log speichern", self.save_event_log),
+                pystray.MenuItem("Firmware aktualisieren", self.start_firmware_update),
                 pystray.MenuItem("Beenden", self.quit_app)
             )
             
@@ -1,79 +1,538 @@
 #include <Arduino.h>
 #include <NimBLEDevice.h>
+#include <NimBLEHIDDevice.h>
+#include <Preferences.h>
 #include <WiFi.h> 
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+#include <esp_pm.h>
+#include <esp_sleep.h>
+#include <esp_timer.h>
+#include <driver/gpio.h>
+#include <soc/gpio_struct.h>
+#include <algorithm>
+#include <atomic>
+#include <sys/time.h>
+#include "hal.h"
+#include "device_config.h"
+#include "remote.h"
+#include "remote_config.h"
+#include "task_queues.h"
+#include "trace_log.h"
 
-// --- KONFIGURATION ---
-#define SERVICE_UUID        "12345678-1234-1234-1234-1234567890ab"
-#define CHAR_BUTTON_UUID    "12345678-1234-1234-1234-1234567890ac"
-#define CHAR_BATTERY_UUID   "12345678-1234-1234-1234-1234567890ad"
-
-// PINS
-const int buttonNextPin = 25; 
-const int buttonPrevPin = 32; 
-const int batteryPin = 36; 
-const int ledPin = 2; // Blaue LED
-
-// EINSTELLUNGEN
-const int BATTERY_INTERVAL = 5000; 
+// ESP32-Teil der Firmware: NimBLE-Server, Tasten-ISRs und die HAL-Funktionen.
+// Die eigentliche Logik steckt in remote.cpp.
 
 NimBLEServer* pServer = nullptr;
 NimBLECharacteristic* pCharButton = nullptr;
 NimBLECharacteristic* pCharBattery = nullptr;
-bool deviceConnected = false;
+NimBLECharacteristic* pCharDiag = nullptr;
+NimBLECharacteristic* pCharMode = nullptr;
+NimBLECharacteristic* pCharLog = nullptr;
+NimBLECharacteristic* pCharConfig = nullptr;
+NimBLECharacteristic* pCharOtaCtrl = nullptr;
+NimBLECharacteristic* pCharOtaData = nullptr;
+NimBLECharacteristic* pCharTimeSync = nullptr;
+// Nur im HID-Modus
+NimBLEHIDDevice* pHid = nullptr;
+NimBLECharacteristic* pCharHidInput = nullptr;
+NimBLECharacteristic* pCharHidBattery = nullptr;
+Preferences prefs;
+
+// Firmware-Tasks (remote::startTasks()). Eingabe ist der Arduino-loop()-Task
+// auf Core 1, allein mit den Tasten-ISRs. BLE-TX und Haushalt laufen auf
+// Core 0 neben dem NimBLE-Host. Geweckt von ISRs, BLE-Callbacks und
+// untereinander über Task-Notifications.
+TaskHandle_t taskHandles[hal::TASK_COUNT] = {};
+const BaseType_t CORE_INPUT = 1;
+const BaseType_t CORE_RADIO = 0;
+const uint32_t TASK_STACK = 4096;
+
+// --- TASTEN INTERRUPTS ---
+// Alle Tasten teilen sich eine ISR. Sie liest die Eingangsregister einmal
+// (digitalRead() ist nicht ISR-sicher) und meldet den Pegel aller Tasten.
+static inline scan::RawInputs IRAM_ATTR readInputRegisters() {
+    return {GPIO.in, GPIO.in1.val};
+}
+
+// Eingänge mit Interrupt: die Taster bzw. die Spalten der Matrix
+const int* const inputPins = BUTTON_KEYS.inputs();
+const size_t inputCount = BUTTON_KEYS.inputCount();
+
+#ifdef BUTTON_MATRIX
+// Zeilen über die Set/Clear-Register schalten (ISR-tauglich), aktiv = LOW
+static void IRAM_ATTR driveRow(int pin, bool active) {
+    const uint32_t bit = 1u << (pin & 31);
+    if (pin < 32) {
+        if (active) GPIO.out_w1tc = bit;
+        else GPIO.out_w1ts = bit;
+    } else {
+        if (active) GPIO.out1_w1tc.val = bit;
+        else GPIO.out1_w1ts.val = bit;
+    }
+    if (active) delayMicroseconds(1);  // Spalten-Pullups nachladen lassen
+}
+
+static uint32_t IRAM_ATTR readKeys() {
+    const uint32_t keys = BUTTON_KEYS.scan(driveRow, readInputRegisters);
+    // Das Umschalten der Zeilen erzeugt selbst Flanken an den Spalten -> verwerfen,
+    // sonst löst der Scan sich bei gehaltener Taste endlos selbst aus
+    GPIO.status_w1tc = scan::registerMask(BUTTON_KEYS.cols, 0);
+    GPIO.status1_w1tc.val = scan::registerMask(BUTTON_KEYS.cols, 1);
+    return keys;
+}
+#else
+static inline uint32_t IRAM_ATTR readKeys() {
+    return BUTTON_KEYS.gather(readInputRegisters());
+}
+#endif
+
+void IRAM_ATTR onButtonIsr(void*) {
+    remote::onButtonEdge(readKeys(), (uint32_t)esp_timer_get_time());
+}
+
+// Abos je Characteristic und Connection-Handle, für hal::blePeers() und
+// hal::bleNotify(). NimBLE vergibt kleine Handles (Verbindungsindex im
+// Controller) -> ein Bit je Handle reicht. Tasten und HID-Input-Report
+// teilen sich SUB_BUTTON, es gibt je nach Modus nur einen von beiden.
+enum Subscription : uint8_t { SUB_BUTTON, SUB_BATTERY, SUB_HID_BATTERY, SUB_LOG, SUB_OTA, SUB_TIME_SYNC, SUB_COUNT };
+std::atomic<uint32_t> subscribers[SUB_COUNT] = {};
+
+static uint32_t handleBit(uint16_t conn) { return 1u << (conn & 31); }
 
 // --- CALLBACKS ---
+// Advertising setzt remote.cpp nach jeder Verbindungsänderung neu (adv_scheduler.h).
+// Signaturen von NimBLE 2.x, damit die Callbacks tatsächlich aufgerufen werden
 class MyServerCallbacks: public NimBLEServerCallbacks {
-    void onConnect(NimBLEServer* pServer) {
-        deviceConnected = true;
-        Serial.println("CALLBACK: Gerät verbunden!");
+    void onConnect(NimBLEServer* pServer, NimBLEConnInfo& connInfo) override {
+        remote::onConnectionChanged(connInfo.getConnHandle(), true);
+        remote::onConnParamsUpdated(connInfo.getConnInterval(), connInfo.getConnLatency());
     };
-    void onDisconnect(NimBLEServer* pServer) {
-        deviceConnected = false;
-        Serial.println("CALLBACK: Gerät getrennt -> Starte Advertising...");
-        NimBLEDevice::startAdvertising();
+    void onDisconnect(NimBLEServer* pServer, NimBLEConnInfo& connInfo, int reason) override {
+        for (auto& s : subscribers) s.fetch_and(~handleBit(connInfo.getConnHandle()), std::memory_order_relaxed);
+        remote::onConnectionChanged(connInfo.getConnHandle(), false);
+    }
+    void onConnParamsUpdate(NimBLEConnInfo& connInfo) override {
+        remote::onConnParamsUpdated(connInfo.getConnInterval(), connInfo.getConnLatency());
+    }
+    void onMTUChange(uint16_t MTU, NimBLEConnInfo& connInfo) override {
+        remote::onMtuChanged(connInfo.getConnHandle(), MTU);
     }
 };
 
-int getBatteryPercentage() {
-  long sum = 0;
-  for(int i = 0; i < 10; i++) {
-    sum += analogRead(batteryPin);
-    delay(5);
-  }
-  int rawValue = sum / 10;
-  float voltage = (rawValue / 4095.0) * 3.3 * 2.43; 
-  int percentage = (int)((voltage - 3.3) / (4.2 - 3.3) * 100);
-  return constrain(percentage, 0, 100);
+// Merkt sich die Abos einer Characteristic, die Notifications sendet
+class NotifyCallbacks: public NimBLECharacteristicCallbacks {
+public:
+    explicit NotifyCallbacks(Subscription sub) : sub_(sub) {}
+    void onSubscribe(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo, uint16_t subValue) override {
+        const uint32_t bit = handleBit(connInfo.getConnHandle());
+        if (subValue != 0) subscribers[sub_].fetch_or(bit, std::memory_order_relaxed);
+        else subscribers[sub_].fetch_and(~bit, std::memory_order_relaxed);
+    }
+private:
+    Subscription sub_;
+};
+
+// Erst wenn der Host die Notifications bestellt hat, ist die Verbindung bereit
+class ButtonCallbacks: public NotifyCallbacks {
+public:
+    ButtonCallbacks() : NotifyCallbacks(SUB_BUTTON) {}
+    void onSubscribe(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo, uint16_t subValue) override {
+        NotifyCallbacks::onSubscribe(pCharacteristic, connInfo, subValue);
+        remote::onButtonSubscribed(connInfo.getConnHandle(), subValue != 0);
+    }
+};
+
+// Modus-Wechsel (0 = Bridge, 1 = HID), wirkt nach dem Neustart
+class ModeCallbacks: public NimBLECharacteristicCallbacks {
+    void onWrite(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo) override {
+        NimBLEAttValue value = pCharacteristic->getValue();
+        if (value.size() > 0) remote::onModeWrite(value.data()[0]);
+    }
+};
+
+// Ereignis-Log: Download (1) bzw. Löschen (2), die Daten kommen als Notifications
+class LogCallbacks: public NotifyCallbacks {
+public:
+    LogCallbacks() : NotifyCallbacks(SUB_LOG) {}
+    void onWrite(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo) override {
+        NimBLEAttValue value = pCharacteristic->getValue();
+        if (value.size() > 0) remote::onLogCommand(value.data()[0]);
+    }
+};
+
+// Konfiguration (TLV-Blob, device_config.h): Schreiben prüft und speichert
+// die loop(), Lesen liefert den Status des letzten Schreibens und den Blob
+class ConfigCallbacks: public NimBLECharacteristicCallbacks {
+    void onWrite(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo) override {
+        NimBLEAttValue value = pCharacteristic->getValue();
+        remote::onConfigWrite(value.data(), value.size());
+    }
+    void onRead(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo) override {
+        uint8_t buf[1 + cfg::MAX_BLOB];
+        size_t len = remote::readConfig(buf, sizeof(buf));
+        pCharacteristic->setValue(buf, len);
+    }
+};
+
+// Firmware-Update: Befehle auf der Steuer-Characteristic, das Image als
+// Write Without Response auf der Daten-Characteristic (läuft im BLE-Task)
+class OtaCtrlCallbacks: public NotifyCallbacks {
+public:
+    OtaCtrlCallbacks() : NotifyCallbacks(SUB_OTA) {}
+    void onWrite(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo) override {
+        NimBLEAttValue value = pCharacteristic->getValue();
+        remote::onOtaCommand(value.data(), value.size());
+    }
+};
+
+class OtaDataCallbacks: public NimBLECharacteristicCallbacks {
+    void onWrite(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo) override {
+        NimBLEAttValue value = pCharacteristic->getValue();
+        remote::onOtaData(value.data(), value.size());
+    }
+};
+
+// Zeitabgleich: Write Without Response, die Antwort kommt als Notification
+class TimeSyncCallbacks: public NotifyCallbacks {
+public:
+    TimeSyncCallbacks() : NotifyCallbacks(SUB_TIME_SYNC) {}
+    void onWrite(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo) override {
+        NimBLEAttValue value = pCharacteristic->getValue();
+        remote::onTimeSyncWrite(value.data(), value.size());
+    }
+};
+
+// Diagnose wird erst beim Lesen zusammengestellt
+class DiagCallbacks: public NimBLECharacteristicCallbacks {
+    void onRead(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo) override {
+        uint8_t buf[remote::DIAG_SIZE];
+        size_t len = remote::readDiagnostics(buf, sizeof(buf));
+        pCharacteristic->setValue(buf, len);
+    }
+};
+
+// --- HAL ---
+namespace hal {
+
+uint32_t millis() { return ::millis(); }
+uint32_t micros() { return ::micros(); }
+
+uint32_t rtcMillis() {
+    // Systemzeit läuft über den RTC-Timer auch im Deep Sleep weiter
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return (uint32_t)((uint64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000);
 }
 
-// LED Feedback (Active HIGH: HIGH=AN, LOW=AUS)
-void blinkFeedback() {
-    digitalWrite(ledPin, HIGH);  
-    delay(100);
-    digitalWrite(ledPin, LOW);   
+void setupButtons() {
+#ifdef BUTTON_MATRIX
+    // In Ruhe alle Zeilen aktiv, damit jeder Druck eine Spalte zieht
+    for (int row : BUTTON_KEYS.rows) {
+        gpio_hold_dis((gpio_num_t)row);  // nach Deep Sleep noch gehalten
+        pinMode(row, OUTPUT);
+        digitalWrite(row, LOW);
+    }
+#endif
+    for (size_t i = 0; i < inputCount; i++) {
+        pinMode(inputPins[i], INPUT_PULLUP);
+        attachInterruptArg(digitalPinToInterrupt(inputPins[i]), onButtonIsr, nullptr, CHANGE);
+    }
 }
 
-void setup() {
-  Serial.begin(115200);
-  WiFi.mode(WIFI_OFF); 
-  
-  pinMode(buttonNextPin, INPUT_PULLUP);
-  pinMode(buttonPrevPin, INPUT_PULLUP);
-  pinMode(ledPin, OUTPUT);
-  digitalWrite(ledPin, LOW); // Start AUS
+uint32_t readButtons() { return readKeys(); }
+
+void setupLed(int pin) {
+    pinMode(pin, OUTPUT);
+    digitalWrite(pin, LOW); // Start AUS
+}
+
+void writeLed(int pin, bool on) { digitalWrite(pin, on ? HIGH : LOW); }
+
+uint16_t readAdc(int pin) { return analogRead(pin); }
+
+uint8_t bleConnectedCount() { return pServer->getConnectedCount(); }
+
+size_t blePeers(BlePeer* out, size_t max) {
+    const uint32_t buttonSubscribers = subscribers[SUB_BUTTON].load(std::memory_order_relaxed);
+    size_t n = 0;
+    for (uint16_t handle : pServer->getPeerDevices()) {
+        if (n == max) break;
+        out[n++] = {handle, pServer->getPeerMTU(handle), (buttonSubscribers & handleBit(handle)) != 0};
+    }
+    return n;
+}
+
+bool isAdvertising() { return NimBLEDevice::getAdvertising()->isAdvertising(); }
+
+void bleAdvertise(uint16_t interval) {
+    NimBLEAdvertising* pAdvertising = NimBLEDevice::getAdvertising();
+    pAdvertising->stop();
+    if (interval == 0) return;
+    pAdvertising->setMinInterval(interval);
+    pAdvertising->setMaxInterval(interval);
+    pAdvertising->start();
+}
+
+// Gilt für alle verbundenen Hosts
+void bleUpdateConnParams(uint16_t minInterval, uint16_t maxInterval, uint16_t latency, uint16_t timeout) {
+    for (uint16_t handle : pServer->getPeerDevices()) {
+        pServer->updateConnParams(handle, minInterval, maxInterval, latency, timeout);
+    }
+}
+
+// notify() mit Connection-Handle meldet, ob der Stack den Wert genommen hat
+// (ohne Handle ist es immer true). Es prüft aber das Abo nicht, das tun wir.
+// setValue() für Lesezugriffe, notify() mit Daten nimmt den Wert nicht auf.
+static bool notifyTo(NimBLECharacteristic* c, Subscription sub, uint16_t conn, const uint8_t* data, size_t len) {
+    if (!c) return true;
+    c->setValue(data, len);
+    if (!(subscribers[sub].load(std::memory_order_relaxed) & handleBit(conn))) return true;
+    return c->notify(data, len, conn);
+}
+
+bool bleNotify(Characteristic ch, uint16_t conn, const uint8_t* data, size_t len) {
+    switch (ch) {
+    case CHAR_BUTTON: return notifyTo(pCharButton, SUB_BUTTON, conn, data, len);
+    case CHAR_HID_INPUT: return notifyTo(pCharHidInput, SUB_BUTTON, conn, data, len);
+    case CHAR_BATTERY:
+        // Windows zeigt den Akkustand einer HID-Tastatur über den Battery
+        // Service. Nimmt der Stack einen der beiden nicht, gehen beide noch
+        // einmal raus, ein doppelter Akkustand schadet nicht.
+        if (!notifyTo(pCharHidBattery, SUB_HID_BATTERY, conn, data, len)) return false;
+        return notifyTo(pCharBattery, SUB_BATTERY, conn, data, len);
+    case CHAR_LOG: return notifyTo(pCharLog, SUB_LOG, conn, data, len);
+    case CHAR_OTA: return notifyTo(pCharOtaCtrl, SUB_OTA, conn, data, len);
+    case CHAR_TIME_SYNC: return notifyTo(pCharTimeSync, SUB_TIME_SYNC, conn, data, len);
+    }
+    return true;
+}
+
+// Schwächste Verbindung, die begrenzt die Reichweite
+int8_t bleRssi() {
+    int8_t weakest = 0;
+    for (uint16_t handle : pServer->getPeerDevices()) {
+        int8_t rssi;
+        if (ble_gap_conn_rssi(handle, &rssi) == 0 && (weakest == 0 || rssi < weakest)) weakest = rssi;
+    }
+    return weakest;
+}
+
+// NimBLE 2.x nimmt dBm und rundet auf die nächste Stufe des Controllers
+void bleSetTxPower(int8_t dbm) {
+    NimBLEDevice::setPower(dbm);
+}
+
+void waitForEvent(uint32_t timeoutMs) {
+    ulTaskNotifyTake(pdTRUE, timeoutMs == 0xFFFFFFFF ? portMAX_DELAY : pdMS_TO_TICKS(timeoutMs));
+}
+
+void wake(Task task) { xTaskNotifyGive(taskHandles[task]); }
+
+void IRAM_ATTR wakeFromISR() {
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(taskHandles[TASK_INPUT], &woken);
+    portYIELD_FROM_ISR(woken);
+}
 
-  analogReadResolution(12);
+void lightSleep(uint32_t timeoutMs) {
+    // Für die Dauer des Schlafs Pegel-Wakeup statt Flanken-Interrupt
+    for (size_t i = 0; i < inputCount; i++) gpio_wakeup_enable((gpio_num_t)inputPins[i], GPIO_INTR_LOW_LEVEL);
+    esp_sleep_enable_gpio_wakeup();
+    if (timeoutMs != 0xFFFFFFFF) esp_sleep_enable_timer_wakeup(timeoutMs * 1000ULL);
+
+    esp_light_sleep_start();
+
+    esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_ALL);
+    for (size_t i = 0; i < inputCount; i++) {
+        gpio_wakeup_disable((gpio_num_t)inputPins[i]);
+        gpio_set_intr_type((gpio_num_t)inputPins[i], GPIO_INTR_ANYEDGE);
+    }
+    // Die Flanke, die geweckt hat, kam während des Schlafs -> nachreichen
+    if (readKeys()) onButtonIsr(nullptr);
+}
+
+void deepSleep() {
+    NimBLEDevice::deinit(true);
+
+#if CONFIG_IDF_TARGET_ESP32
+    // Weck-Trigger scharfschalten: erster Eingang über ext0, zweiter über ext1.
+    // ext1 kann hier nur "alle LOW", deshalb wecken weitere Tasten nicht
+    // (siehe BUTTON_KEYS).
+    esp_sleep_enable_ext0_wakeup((gpio_num_t)inputPins[0], 0);
+    if (inputCount > 1) esp_sleep_enable_ext1_wakeup(1ULL << inputPins[1], ESP_EXT1_WAKEUP_ALL_LOW);
+#else
+    // Neuere Chips kennen ext1 "irgendeiner LOW": jeder RTC-fähige Eingang weckt.
+    // Ohne ext0 bleiben die RTC-Peripherals und damit die Pull-ups nur so an.
+    uint64_t wakeMask = 0;
+    for (size_t i = 0; i < inputCount; i++)
+        if (esp_sleep_is_valid_wakeup_gpio((gpio_num_t)inputPins[i])) wakeMask |= 1ULL << inputPins[i];
+    esp_sleep_pd_config(ESP_PD_DOMAIN_RTC_PERIPH, ESP_PD_OPTION_ON);
+    esp_sleep_enable_ext1_wakeup(wakeMask, ESP_EXT1_WAKEUP_ANY_LOW);
+#endif
+#ifdef BUTTON_MATRIX
+    // Zeilen bleiben im Deep Sleep aktiv (LOW), sonst zieht kein Druck die Spalten
+    for (int row : BUTTON_KEYS.rows) gpio_hold_en((gpio_num_t)row);
+    gpio_deep_sleep_hold_en();
+#endif
+
+    Serial.flush();
+    esp_deep_sleep_start();
+}
+
+uint8_t wakeButton() {
+    const esp_sleep_wakeup_cause_t cause = esp_sleep_get_wakeup_cause();
+    if (cause != ESP_SLEEP_WAKEUP_EXT0 && cause != ESP_SLEEP_WAKEUP_EXT1) return 0;
+#ifdef BUTTON_MATRIX
+    // Spalte allein sagt nicht, welche Taste -> Matrix abfragen (Taste ist noch gedrückt)
+    const uint32_t keys = readKeys();
+    return keys ? (uint8_t)(__builtin_ctz(keys) + 1) : 0;
+#elif CONFIG_IDF_TARGET_ESP32
+    return cause == ESP_SLEEP_WAKEUP_EXT0 ? 1 : 2;
+#else
+    const uint64_t pins = esp_sleep_get_ext1_wakeup_status();
+    for (size_t i = 0; i < inputCount; i++)
+        if (pins & (1ULL << inputPins[i])) return (uint8_t)(i + 1);
+    return 0;
+#endif
+}
+
+// esp_timer zählt ab dem Start der App; ROM und Bootloader davor (einige
+// 10 ms) fehlen, der Druck war also etwas früher
+uint32_t wakeMillis() { return rtcMillis() - (uint32_t)(esp_timer_get_time() / 1000); }
+
+size_t settingsRead(const char* key, void* data, size_t len) {
+    if (!prefs.isKey(key)) return 0;
+    return prefs.getBytes(key, data, len);
+}
+
+bool settingsWrite(const char* key, const void* data, size_t len) {
+    return prefs.putBytes(key, data, len) == len;
+}
+
+// Ereignis-Log am Anfang der SPIFFS-Partition der Standard-Partitionstabelle
+static const esp_partition_t* logPartition() {
+    static const esp_partition_t* p =
+        esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_SPIFFS, nullptr);
+    return p;
+}
+
+size_t logFlashSectorSize() { return SPI_FLASH_SEC_SIZE; }
+
+size_t logFlashSectors() {
+    const esp_partition_t* p = logPartition();
+    return p ? std::min(LOG_SECTORS, (size_t)(p->size / SPI_FLASH_SEC_SIZE)) : 0;
+}
+
+bool logFlashRead(uint32_t addr, void* data, size_t len) {
+    return esp_partition_read(logPartition(), addr, data, len) == ESP_OK;
+}
+
+bool logFlashWrite(uint32_t addr, const void* data, size_t len) {
+    return esp_partition_write(logPartition(), addr, data, len) == ESP_OK;
+}
+
+bool logFlashErase(uint32_t sector) {
+    return esp_partition_erase_range(logPartition(), sector * SPI_FLASH_SEC_SIZE, SPI_FLASH_SEC_SIZE) == ESP_OK;
+}
+
+// Update geht in die jeweils andere App-Partition (ota_0 / ota_1)
+static const esp_partition_t* otaPartition() {
+    static const esp_partition_t* p = esp_ota_get_next_update_partition(nullptr);
+    return p;
+}
+
+size_t otaCapacity() {
+    const esp_partition_t* p = otaPartition();
+    return p ? p->size : 0;
+}
+
+bool otaErase(uint32_t offset, size_t len) {
+    return esp_partition_erase_range(otaPartition(), offset, len) == ESP_OK;
+}
+
+bool otaWrite(uint32_t offset, const void* data, size_t len) {
+    return esp_partition_write(otaPartition(), offset, data, len) == ESP_OK;
+}
+
+bool otaRead(uint32_t offset, void* data, size_t len) {
+    return esp_partition_read(otaPartition(), offset, data, len) == ESP_OK;
+}
+
+// esp_ota_set_boot_partition() prüft Header und Segmente des Images
+bool otaActivate(size_t) {
+    return esp_ota_set_boot_partition(otaPartition()) == ESP_OK;
+}
+
+void restart() {
+    Serial.flush();
+    ESP.restart();
+}
+
+// Bis hierher bleiben LOG-Zeilen im Trace-Puffer: logWrite() nimmt ohne
+// Serial.begin() nichts an
+void bootDeferred() {
+    Serial.begin(115200);
+    WiFi.mode(WIFI_OFF);
+    analogReadResolution(12);
+
+#if CONFIG_PM_ENABLE
+    // Im Idle den Takt senken (BLE braucht mind. 80 MHz). Automatischer Light
+    // Sleep bleibt aus: er würde die Tasten-Interrupts und den BLE-Takt ohne
+    // 32-kHz-Quarz stören. Light Sleep gibt es gezielt über hal::lightSleep().
+    esp_pm_config_esp32_t pmConfig = {};
+    pmConfig.max_freq_mhz = 240;
+    pmConfig.min_freq_mhz = 80;
+    pmConfig.light_sleep_enable = false;
+    esp_pm_configure(&pmConfig);
+#endif
+}
+
+// Nur schreiben, was der UART-Puffer ohne Blockieren nimmt
+bool logWrite(const char* line, size_t len) {
+    if ((size_t)Serial.availableForWrite() < len) return false;
+    Serial.write((const uint8_t*)line, len);
+    return true;
+}
+
+}  // namespace hal
+
+static void txTaskMain(void*) {
+  for (;;) remote::txTask();
+}
+
+static void housekeepingTaskMain(void*) {
+  for (;;) remote::housekeepingTask();
+}
+
+void setup() {
+  taskHandles[hal::TASK_INPUT] = xTaskGetCurrentTaskHandle();
+  // Bis zum Advertising nur Einstellungen, Tasten und BLE. Serial, WLAN, ADC
+  // und Energieverwaltung folgen im Haushalts-Task (hal::bootDeferred()).
+  prefs.begin("remote", false);
+  remote::begin();
+  const bool hidMode = remote::mode() == remote::MODE_HID;
 
   // NimBLE Init
-  NimBLEDevice::init("Remote-Switch");
+  NimBLEDevice::init(remote::deviceName());
   
-  // WICHTIG: Security Settings für Windows Kompatibilität
-  NimBLEDevice::setSecurityAuth(false, false, false);
-  NimBLEDevice::setPower(ESP_PWR_LVL_P9); 
+  // WICHTIG: Security Settings für Windows Kompatibilität.
+  // Bridge ohne Pairing; eine HID-Tastatur verlangt Bonding (ohne PIN).
+  // Nur die OTA-Characteristics verlangen Verschlüsselung (WRITE_ENC), der
+  // Host koppelt dafür beim ersten Update; echt macht ein Image die Signatur.
+  if (hidMode) {
+    NimBLEDevice::setSecurityAuth(true, false, true);
+    NimBLEDevice::setSecurityIOCap(BLE_HS_IO_NO_INPUT_OUTPUT);
+  } else {
+    NimBLEDevice::setSecurityAuth(false, false, false);
+  }
+  NimBLEDevice::setPower(remote::txPowerDbm());
 
   pServer = NimBLEDevice::createServer();
   pServer->setCallbacks(new MyServerCallbacks());
+  pServer->advertiseOnDisconnect(false);   // remote.cpp entscheidet (adv_scheduler.h)
 
+  // Eigener Service gibt es in beiden Modi (Akku, Diagnose, Modus-Wechsel)
   NimBLEService* pService = pServer->createService(SERVICE_UUID);
 
   pCharButton = pService->createCharacteristic(
@@ -85,75 +544,94 @@ void setup() {
                       CHAR_BATTERY_UUID,
                       NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::NOTIFY
                   );
+  pCharBattery->setCallbacks(new NotifyCallbacks(SUB_BATTERY));
+
+  pCharDiag = pService->createCharacteristic(
+                      CHAR_DIAG_UUID,
+                      NIMBLE_PROPERTY::READ
+                  );
+  pCharDiag->setCallbacks(new DiagCallbacks());
+
+  pCharMode = pService->createCharacteristic(
+                      CHAR_MODE_UUID,
+                      NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::WRITE
+                  );
+  pCharMode->setValue((uint8_t)remote::mode());
+  pCharMode->setCallbacks(new ModeCallbacks());
+
+  pCharLog = pService->createCharacteristic(
+                      CHAR_LOG_UUID,
+                      NIMBLE_PROPERTY::WRITE | NIMBLE_PROPERTY::NOTIFY
+                  );
+  pCharLog->setCallbacks(new LogCallbacks());
+
+  pCharConfig = pService->createCharacteristic(
+                      CHAR_CONFIG_UUID,
+                      NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::WRITE
+                  );
+  pCharConfig->setCallbacks(new ConfigCallbacks());
+
+  pCharOtaCtrl = pService->createCharacteristic(
+                      CHAR_OTA_CTRL_UUID,
+                      NIMBLE_PROPERTY::WRITE | NIMBLE_PROPERTY::WRITE_ENC | NIMBLE_PROPERTY::NOTIFY
+                  );
+  pCharOtaCtrl->setCallbacks(new OtaCtrlCallbacks());
+
+  pCharOtaData = pService->createCharacteristic(
+                      CHAR_OTA_DATA_UUID,
+                      NIMBLE_PROPERTY::WRITE_NR | NIMBLE_PROPERTY::WRITE_ENC
+                  );
+  pCharOtaData->setCallbacks(new OtaDataCallbacks());
+
+  pCharTimeSync = pService->createCharacteristic(
+                      CHAR_TIME_SYNC_UUID,
+                      NIMBLE_PROPERTY::WRITE_NR | NIMBLE_PROPERTY::NOTIFY
+                  );
+  pCharTimeSync->setCallbacks(new TimeSyncCallbacks());
 
   pService->start();
 
   NimBLEAdvertising* pAdvertising = NimBLEDevice::getAdvertising();
+
+  if (hidMode) {
+    pHid = new NimBLEHIDDevice(pServer);
+    pHid->setManufacturer("Remote-Switch");
+    pHid->setPnp(0x02, 0xE502, 0xA111, 0x0210);
+    pHid->setHidInfo(0x00, 0x01);
+    pHid->setReportMap((uint8_t*)hid::REPORT_MAP, sizeof(hid::REPORT_MAP));
+    pCharHidInput = pHid->getInputReport(hid::REPORT_ID);
+    // Bereit ist die Verbindung, sobald das Betriebssystem den Report bestellt hat
+    pCharHidInput->setCallbacks(new ButtonCallbacks());
+    // Battery Level (0x2A19) des Battery Service, Abos wie bei den eigenen
+    pCharHidBattery = pHid->getBatteryService()->getCharacteristic(NimBLEUUID((uint16_t)0x2a19));
+    pCharHidBattery->setCallbacks(new NotifyCallbacks(SUB_HID_BATTERY));
+    pHid->getDeviceInfoService()->start();
+    pHid->getHidService()->start();
+    pHid->getBatteryService()->start();
+
+    pAdvertising->setAppearance(HID_KEYBOARD);
+    pAdvertising->addServiceUUID(pHid->getHidService()->getUUID());
+  } else {
+    pCharButton->setCallbacks(new ButtonCallbacks());
+  }
+
   pAdvertising->addServiceUUID(SERVICE_UUID);
   
   NimBLEAdvertisementData scanResponseData;
-  scanResponseData.setName("Remote-Switch"); 
+  scanResponseData.setName(remote::deviceName());
   pAdvertising->setScanResponseData(scanResponseData);
-  
-  pAdvertising->start();
-  
-  Serial.println("ESP32 Bereit. Warte auf Verbindung...");
-  
-  // Start-Signal
-  blinkFeedback();
+  // Advertising startet der erste Durchlauf von remote::inputTask()
+
+  LOG(MSG_READY);
+
+  remote::startTasks();
+  xTaskCreatePinnedToCore(txTaskMain, "ble-tx", TASK_STACK, nullptr, tasks::PRIO_TX,
+                          &taskHandles[hal::TASK_TX], CORE_RADIO);
+  xTaskCreatePinnedToCore(housekeepingTaskMain, "housekeeping", TASK_STACK, nullptr, tasks::PRIO_HOUSEKEEPING,
+                          &taskHandles[hal::TASK_HOUSEKEEPING], CORE_RADIO);
+  vTaskPrioritySet(nullptr, tasks::PRIO_INPUT);
 }
 
 void loop() {
-  // ROBUSTER CHECK: Verlassen wir uns nicht nur auf den Callback
-  if (pServer->getConnectedCount() > 0) {
-      if (!deviceConnected) {
-          deviceConnected = true; // Fallback, falls Callback verschluckt wurde
-          Serial.println("LOOP-CHECK: Verbindung erkannt!");
-      }
-
-      // 1. Tastenabfrage
-      if (digitalRead(buttonNextPin) == LOW) {
-          Serial.println("Taste NEXT (25) gedrückt");
-          uint8_t val = 1; 
-          pCharButton->setValue(&val, 1);
-          pCharButton->notify();
-          blinkFeedback(); 
-          delay(250);      
-      }
-      
-      if (digitalRead(buttonPrevPin) == LOW) {
-          Serial.println("Taste PREV (32) gedrückt");
-          uint8_t val = 2; 
-          pCharButton->setValue(&val, 1);
-          pCharButton->notify();
-          blinkFeedback(); 
-          delay(250);     
-      }
-
-      // 2. Akku Senden (Timer)
-      static unsigned long lastBat = 0;
-      if (millis() - lastBat > BATTERY_INTERVAL) {
-          lastBat = millis();
-          uint8_t level = getBatteryPercentage();
-          // Serial.printf("Sende Akku: %d%%\n", level); // Optionales Debugging
-          pCharBattery->setValue(&level, 1);
-          pCharBattery->notify();
-      }
-      
-  } else {
-      // Wenn nicht verbunden, stellen wir sicher, dass der Status stimmt
-      if (deviceConnected) {
-          deviceConnected = false;
-          Serial.println("LOOP-CHECK: Verbindung verloren.");
-      }
-      
-      // Kleiner Hinweis im Monitor alle paar Sekunden
-      static unsigned long lastWait = 0;
-      if (millis() - lastWait > 3000) {
-          lastWait = millis();
-          Serial.println("... warte auf App ...");
-      }
-  }
-  
-  delay(10); 
-}
\ No newline at end of file
+  remote::inputTask();
+}
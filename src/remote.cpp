@@ -0,0 +1,1381 @@
+#include "remote.h"
+#include <atomic>
+#include "adv_scheduler.h"
+#include "battery_sampler.h"
+#include "button_events.h"
+#include "button_packet.h"
+#include "button_scanner.h"
+#include "debouncer.h"
+#include "conn_params.h"
+#include "device_config.h"
+#include "event_ring.h"
+#include "flash_log.h"
+#include "gesture_engine.h"
+#include "hal.h"
+#include "latency_histogram.h"
+#include "link_table.h"
+#include "ota_key.h"
+#include "ota_receiver.h"
+#include "remote_config.h"
+#include "replay_buffer.h"
+#include "task_queues.h"
+#include "time_sync.h"
+#include "timer_service.h"
+#include "trace_log.h"
+
+namespace remote {
+
+// Timer-IDs für den TimerService
+enum TimerId : uint8_t {
+    TIMER_LED_OFF,
+    TIMER_BATTERY,
+    TIMER_WAIT_HINT,
+    TIMER_SCAN,
+    TIMER_DEEP_SLEEP,
+    TIMER_CONN_IDLE,
+    TIMER_CONN_REQUEST,
+    TIMER_GESTURE,
+    TIMER_RESTART,
+    TIMER_MACRO,
+    TIMER_ADV_PHASE,
+    TIMER_COUNT
+};
+
+// Timer des Haushalts-Tasks (eigener TimerService)
+enum HousekeepingTimerId : uint8_t {
+    HK_BATTERY_SAMPLE,
+    HK_LOG_FLUSH,
+    HK_LOG_STREAM,
+    HK_TIMER_COUNT
+};
+
+// Bridge oder HID, aus dem NVS; Wechsel kommt aus dem BLE-Task
+Mode currentMode = MODE_BRIDGE;
+volatile uint8_t requestedMode = MODE_COUNT;
+
+// Verbundene Centrals mit Abo-Zustand; Änderungen kommen aus dem BLE-Task
+// über linkEvents und werden nur in der loop() übernommen
+EventRing<link::Event, 16> linkEvents;
+link::Table<MAX_CENTRALS> links;
+uint32_t linkDropsSeen = 0;     // linkEvents.dropped() beim letzten Abgleich
+bool deviceConnected = false;   // mindestens ein Central
+bool wasConnected = false;
+
+// Advertising-Phasen ohne Verbindung (config.advPhases). advertisingDirty:
+// Intervall neu setzen, gesammelt einmal je loop()-Durchlauf.
+adv::Scheduler advertising;
+bool advertisingDirty = false;
+
+// Log-Befehl kommt aus dem BLE-Task
+volatile uint8_t logCommand = 0;
+
+// Laufzeit-Einstellungen (device_config.h). Ein neuer Blob kommt aus dem
+// BLE-Task in configIn; configPending gibt den Puffer an die loop() und
+// erst nach der Verarbeitung wieder frei.
+cfg::Settings config = cfg::defaults();
+// Gültiger Blob wie im NVS, doppelt gepuffert: Die loop() schreibt die freie
+// Kopie und schaltet configCurrent erst danach um, der BLE-Task liest beim
+// Lesen der Characteristic immer eine vollständige Kopie. Während er liest,
+// kann er keinen neuen Blob annehmen -> höchstens ein Umschalten, die
+// gelesene Kopie wird dabei nicht überschrieben.
+struct ConfigCopy {
+    uint8_t data[cfg::MAX_BLOB];
+    size_t len;
+};
+ConfigCopy configCopies[2] = {};
+std::atomic<uint8_t> configCurrent{0};
+uint8_t configIn[cfg::MAX_BLOB];
+size_t configInLen = 0;
+std::atomic<bool> configPending{false};
+volatile uint8_t configStatus = cfg::OK;
+char advertisedName[cfg::MAX_NAME + 1];   // Name aus begin(), gilt bis zum Neustart
+
+// Verbindungsparameter: schnell nach Tastendruck, sparsam nach Ruhephase.
+// Updates kommen aus dem BLE-Task und werden in der loop() übernommen.
+conn::Manager connParams;
+volatile bool connParamsChanged = false;
+volatile uint16_t connInterval = 0;
+volatile uint16_t connLatency = 0;
+
+// Drücke ab dem Aufwachen bzw. ohne bereite Verbindung; liegt im RTC-Speicher
+HAL_RTC_DATA ReplayBuffer<16> replay;
+HAL_RTC_DATA uint32_t replayDropsLogged;
+
+// Entprellter Zustand aller Tasten als Maske (Bit i = ButtonId i+1), Strategie
+// je Taste aus config.debounceStrategies. bounceStartUs: je Taste die erste
+// Flanke ihrer laufenden Abtastung (Bit in bouncing), Zeitstempel für Drücke,
+// die erst ein Tick bestätigt.
+scan::Debouncer buttons;
+uint32_t bounceStartUs[cfg::MAX_BUTTONS];
+uint32_t bouncing = 0;
+
+static void onGesture(uint8_t code, uint8_t count, uint32_t edgeUs, void*);
+
+// Macht aus entprellten Flanken Klick / lang / doppelt / Dauerfeuer / Akkord
+gesture::Engine<BUTTON_COUNT> gestures(onGesture);
+static_assert(!GESTURE_CHORD || BUTTON_COUNT <= gesture::MAX_CHORD_BUTTON, "Akkord-Code hat nur Bits für die Tasten 1-4");
+
+static void noteActivity();
+
+// Flanken aus den ISRs, wird nur in loop() geleert
+EventRing<ButtonEvent, 64> buttonEvents;
+uint32_t buttonQueuePeak = 0;   // höchster Füllstand, gemessen vor dem Leeren
+TimerService<TIMER_COUNT> timers;
+
+// --- TASKS ---
+// Eingabe, BLE-TX und Haushalt teilen sich nur die Schlangen aus
+// task_queues.h und die Atomics hier. Ohne eigene Tasks (Simulator) ruft
+// loop() die drei Stufen nacheinander auf.
+typedef tasks::TxItem<packet::MAX_PACKET_SIZE, 8> TxItem;
+typedef tasks::TxItem<2 + 20 * flashlog::SLOT_SIZE, 0> BulkItem;   // Log-Block bis MTU 247
+
+EventRing<TxItem, 16> txQueue;
+EventRing<BulkItem, 4> bulkQueue;
+EventRing<flashlog::Record, 32> logQueue;
+EventRing<link::Table<MAX_CENTRALS>, 2> linkSnapshots;
+bool ownTasks = false;
+bool linksDirty = false;                 // links geändert, Kopie noch nicht beim TX-Task
+link::Table<MAX_CENTRALS> txLinks;       // nur im TX-Task
+// Verbindungen (Bit je Connection-Handle), die das vorderste Element von
+// txQueue bzw. bulkQueue schon angenommen haben. Nur der TX-Task.
+uint32_t txSentTo = 0;
+uint32_t bulkSentTo = 0;
+
+std::atomic<bool> txBlocked{false};                 // txQueue war voll, Eingabe wartet
+std::atomic<bool> linkUp{false};                    // Eingabe -> Haushalt: deviceConnected
+std::atomic<uint16_t> linkMtu{23};                  // Eingabe -> Haushalt: kleinste MTU
+std::atomic<uint8_t> batteryLevel{0xFF};            // Haushalt -> Eingabe, 0xFF = noch kein Wert
+std::atomic<uint8_t> housekeepingCommand{0};        // LOG_CMD_* an den Haushalt
+std::atomic<bool> housekeepingSync{false};          // Flash-Log und Log-Ausgabe leeren
+std::atomic<bool> housekeepingIdle{true};           // nichts halb ausgegeben (Light Sleep erlaubt)
+std::atomic<uint32_t> housekeepingWakeAt{TimerService<HK_TIMER_COUNT>::NO_DEADLINE};   // millis()
+std::atomic<uint32_t> logStreamResult{0};           // fertiger Download: Datensätze << 16 | Blöcke
+std::atomic<bool> bootDeferredPending{false};       // Eingabe -> Haushalt: Rest des Starts erledigen
+std::atomic<bool> bootDeferredDone{false};          // Haushalt -> Eingabe: fertig, Startzeiten melden
+
+TimerService<HK_TIMER_COUNT> hkTimers;   // nur im Haushalt
+battery::Sampler<> batterySampler;       // nur im Haushalt
+
+// Tastendrücke seit der letzten Notification, gehen gesammelt raus
+packet::ButtonPacket pendingButtons;
+uint16_t buttonSeq = 0;
+// Volle, schon nummerierte Pakete, die txQueue noch nicht genommen hat; sie
+// gehen vor pendingButtons raus. Erst wenn auch hier kein Platz ist, geht ein
+// Druck verloren: gezählt (Diagnose) und als Lücke in der Sequenznummer.
+const size_t BUTTON_BACKLOG = 4;
+packet::ButtonPacket buttonBacklog[BUTTON_BACKLOG];
+size_t backlogHead = 0, backlogCount = 0;
+uint32_t buttonsLost = 0;
+bool buttonGap = false;   // nach dem nächsten Paket eine Nummer überspringen
+
+// --- START ---
+// Zeitpunkte je BootPhase (hal::micros), geschrieben von Eingabe und
+// Haushalt, gelesen auch aus dem BLE-Task (Diagnose)
+std::atomic<uint32_t> bootPhases[BOOT_PHASE_COUNT];
+uint8_t bootWakePress = 0;   // für den Start-Datensatz im Flash-Log
+bool logMounted = false;     // gilt für die Eingabe ab bootDeferredDone
+
+// --- LATENZ-MESSUNG ---
+// Je Tastendruck: Zeit von der Flanke (ISR) bis zur jeweiligen Stufe
+LatencyHistogram latency[STAGE_COUNT];
+
+// Flanken-Zeitstempel der Drücke in pendingButtons (Überlauf wird nicht gemessen)
+const size_t MAX_TRACKED_PRESSES = 32;
+uint32_t pendingEdgeUs[MAX_TRACKED_PRESSES];
+size_t pendingEdgeCount = 0;
+
+// Alle Tasten-ISRs laufen über denselben GPIO-Handler und unterbrechen sich
+// nicht gegenseitig -> es gibt genau einen Producer für buttonEvents.
+void HAL_ISR_ATTR onButtonEdge(uint32_t mask, uint32_t timeUs) {
+    buttonEvents.push({timeUs, mask});
+    hal::wakeFromISR();
+}
+
+// Alle BLE-Callbacks laufen im NimBLE-Host-Task -> ein Producer für linkEvents
+void onConnectionChanged(uint16_t conn, bool connected) {
+    linkEvents.push({connected ? link::LINK_UP : link::LINK_DOWN, conn, 0});
+    hal::wake();
+}
+
+void onButtonSubscribed(uint16_t conn, bool subscribed) {
+    linkEvents.push({link::LINK_SUBSCRIBE, conn, subscribed});
+    hal::wake();
+}
+
+void onConnParamsUpdated(uint16_t interval, uint16_t latency) {
+    connInterval = interval;
+    connLatency = latency;
+    connParamsChanged = true;
+    hal::wake();
+}
+
+Mode mode() {
+    return currentMode;
+}
+
+void onModeWrite(uint8_t m) {
+    requestedMode = m;
+    hal::wake();
+}
+
+void onLogCommand(uint8_t cmd) {
+    logCommand = cmd;
+    hal::wake();
+}
+
+void onMtuChanged(uint16_t conn, uint16_t mtu) {
+    linkEvents.push({link::LINK_MTU, conn, mtu});
+    hal::wake();
+}
+
+void onConfigWrite(const uint8_t* data, size_t len) {
+    if (configPending.load(std::memory_order_acquire)) {
+        configStatus = cfg::ERR_BUSY;
+        return;
+    }
+    if (len > cfg::MAX_BLOB) {
+        configStatus = cfg::ERR_LENGTH;
+        return;
+    }
+    memcpy(configIn, data, len);
+    configInLen = len;
+    configPending.store(true, std::memory_order_release);
+    hal::wake();
+}
+
+const char* deviceName() {
+    return advertisedName;
+}
+
+int8_t txPowerDbm() {
+    return config.txPowerDbm;
+}
+
+// Mindestens ein Host hört auf die Tasten-Characteristic (im HID-Modus auf
+// den Input-Report). Jede Notification erreicht alle, die zuhören.
+static bool linkReady() {
+    return links.subscribed() > 0;
+}
+
+// --- VERBINDUNGSPARAMETER ---
+static void onConnRequestTimeout(void*) {
+    connParams.onTimeout();
+}
+
+static void requestConnProfile(conn::Profile p) {
+    if (!connParams.want(p)) return;
+    const conn::Params& params = conn::PROFILES[p];
+    LOG(MSG_CONN_REQUEST, params.minInterval, params.maxInterval);
+    hal::bleUpdateConnParams(params.minInterval, params.maxInterval, params.latency, params.timeout);
+    timers.startOnce(TIMER_CONN_REQUEST, hal::millis(), CONN_REQUEST_TIMEOUT, onConnRequestTimeout);
+}
+
+static void onConnQuiet(void*) {
+    // Läuft noch eine Anfrage, später erneut versuchen
+    if (connParams.pending()) {
+        timers.startOnce(TIMER_CONN_IDLE, hal::millis(), CONN_REQUEST_TIMEOUT, onConnQuiet);
+        return;
+    }
+    requestConnProfile(conn::PROFILE_IDLE);
+}
+
+static void noteConnActivity() {
+    timers.startOnce(TIMER_CONN_IDLE, hal::millis(), CONN_IDLE_AFTER, onConnQuiet);
+}
+
+// Haushalt, nicht blockierend: pro Timer-Tick genau eine ADC-Messung
+static void sampleBattery(void*) {
+    batterySampler.addSample(hal::readAdc(batteryPin));
+    if (batterySampler.ready()) batteryLevel.store(batterySampler.percent(), std::memory_order_relaxed);
+}
+
+// LED Feedback (Active HIGH: HIGH=AN, LOW=AUS)
+// Nicht blockierend: LED an, Timer schaltet sie wieder aus
+static void ledOff(void*) {
+    hal::writeLed(ledPin, false);
+}
+
+static void blinkFeedback() {
+    if (config.ledBlinkMs == 0) return;
+    hal::writeLed(ledPin, true);
+    timers.startOnce(TIMER_LED_OFF, hal::millis(), config.ledBlinkMs, ledOff);
+}
+
+static void recordStage(LatencyStage stage) {
+    const uint32_t now = hal::micros();
+    for (size_t i = 0; i < pendingEdgeCount; i++) latency[stage].record(now - pendingEdgeUs[i]);
+}
+
+// Notification an den BLE-TX-Task übergeben. false, wenn txQueue voll ist;
+// der TX-Task weckt die Eingabe, sobald wieder Platz ist.
+static bool sendTx(hal::Characteristic ch, const uint8_t* data, size_t len, const uint32_t* edgeUs, size_t edges) {
+    TxItem item;
+    item.ch = ch;
+    item.len = (uint16_t)len;
+    memcpy(item.data, data, len);
+    item.edgeCount = (uint8_t)std::min(edges, sizeof(item.edgeUs) / sizeof(item.edgeUs[0]));
+    memcpy(item.edgeUs, edgeUs, item.edgeCount * sizeof(uint32_t));
+    if (!txQueue.push(item)) {
+        txBlocked.store(true, std::memory_order_relaxed);
+        return false;
+    }
+    if (ownTasks) hal::wake(hal::TASK_TX);
+    return true;
+}
+
+// Sequenznummer für pendingButtons vergeben
+static uint16_t takeButtonSeq() {
+    const uint16_t seq = buttonSeq++;
+    if (buttonGap) buttonSeq++;
+    buttonGap = false;
+    return seq;
+}
+
+// Übergibt zuerst zurückgestellte Pakete, dann alle gesammelten Tastendrücke
+// als ein Paket. Ist txQueue voll, bleibt der Rest liegen und geht beim
+// nächsten Durchlauf raus.
+static void flushButtons() {
+    uint8_t buf[packet::MAX_PACKET_SIZE];
+    while (backlogCount > 0) {
+        const size_t len = packet::encode(buttonBacklog[backlogHead], buf);
+        if (!sendTx(hal::CHAR_BUTTON, buf, len, nullptr, 0)) return;
+        backlogHead = (backlogHead + 1) % BUTTON_BACKLOG;
+        backlogCount--;
+    }
+    if (pendingButtons.empty()) return;
+    pendingButtons.seq = buttonSeq;
+    size_t len = packet::encode(pendingButtons, buf);
+    if (!sendTx(hal::CHAR_BUTTON, buf, len, pendingEdgeUs, pendingEdgeCount)) return;
+    takeButtonSeq();
+    recordStage(STAGE_ENCODED);
+    pendingButtons.clear();
+    pendingEdgeCount = 0;
+}
+
+// Einen Eintrag an pendingButtons hängen. Ist das Paket voll und nimmt
+// txQueue es nicht, wird es nummeriert zurückgestellt (buttonBacklog).
+// false, wenn der Druck verloren ist.
+static bool addButton(uint8_t code, uint32_t edgeUs, uint8_t count) {
+    if (!pendingButtons.add(code, edgeUs, count)) {
+        flushButtons();
+        if (!pendingButtons.empty()) {
+            if (backlogCount == BUTTON_BACKLOG) {
+                buttonsLost += count;
+                buttonGap = true;
+                return false;
+            }
+            pendingButtons.seq = takeButtonSeq();
+            recordStage(STAGE_ENCODED);   // Notify-Latenz wird für zurückgestellte nicht gemessen
+            buttonBacklog[(backlogHead + backlogCount++) % BUTTON_BACKLOG] = pendingButtons;
+            pendingButtons.clear();
+            pendingEdgeCount = 0;
+        }
+        pendingButtons.add(code, edgeUs, count);
+    }
+    return true;
+}
+
+// --- HID-MAKROS ---
+// Im HID-Modus wird jeder Code zu einem Makro aus HID_MACROS. Die fertigen
+// Reports spielt der MacroPlayer nach Zeit ab (TIMER_MACRO), weitere Drücke
+// warten in seiner Schlange, die loop() blockiert dabei nie.
+typedef hid::MacroTable<64, 16> HidMacroTable;
+HidMacroTable hidMacros;
+hid::MacroPlayer<HidMacroTable, 8> macroPlayer(hidMacros);
+
+// Platz in txQueue hat playMacros() vorher geprüft, push() gelingt also
+static void sendMacroReport(const uint8_t* report, size_t len, uint32_t edgeUs, bool first) {
+    sendTx(hal::CHAR_HID_INPUT, report, len, &edgeUs, first ? 1 : 0);
+}
+
+// Makros aus der Konfiguration, ohne eigene die aus HID_MACROS
+static bool buildMacros(const cfg::Settings& s) {
+    if (s.macroCount == 0) return hidMacros.build(HID_MACROS, sizeof(HID_MACROS) / sizeof(HID_MACROS[0]));
+    hid::MacroSource sources[cfg::MAX_MACROS];
+    return hidMacros.build(sources, cfg::macroSources(s, sources));
+}
+
+static void playMacros(void*) {
+    const uint32_t now = hal::millis();
+    // Nur die Eingabe füllt txQueue: der freie Platz kann nur wachsen
+    macroPlayer.run(now, txQueue.capacity() - txQueue.size(), sendMacroReport);
+    uint32_t wait = macroPlayer.timeUntilNext(now);
+    if (macroPlayer.blocked()) {
+        // TX-Task weckt die Eingabe, sobald Platz ist; sonst nach TX_RETRY_MS
+        txBlocked.store(true, std::memory_order_relaxed);
+        wait = TX_RETRY_MS;
+    }
+    if (wait == hid::MacroPlayer<HidMacroTable, 8>::NO_DEADLINE) timers.cancel(TIMER_MACRO);
+    else timers.startOnce(TIMER_MACRO, now, wait, playMacros);
+}
+
+static void startMacro(uint8_t code, uint32_t edgeUs) {
+    if (!macroPlayer.enqueue(code, edgeUs, hal::millis())) {
+        if (macroPlayer.full()) LOG(MSG_MACRO_QUEUE_FULL, code);
+        else LOG(MSG_MACRO_UNMAPPED, code);
+        return;
+    }
+    latency[STAGE_ENCODED].record(hal::micros() - edgeUs);
+    playMacros(nullptr);
+}
+
+// count > 1: gesammelte Wiederholungen beim Dauerfeuer, ein Eintrag mit Zähler
+static void queueButton(uint8_t code, uint8_t count, uint32_t edgeUs) {
+    if (currentMode == MODE_HID) {
+        for (uint8_t i = 0; i < count; i++) startMacro(code, edgeUs);
+        return;
+    }
+    if (addButton(code, edgeUs, count) && pendingEdgeCount < MAX_TRACKED_PRESSES) pendingEdgeUs[pendingEdgeCount++] = edgeUs;
+}
+
+static void sendBattery(void*) {
+    if (!deviceConnected) return;
+    uint8_t level = batteryLevel.load(std::memory_order_relaxed);
+    if (level == 0xFF) return;
+    LOG(MSG_BATTERY, level);
+    sendTx(hal::CHAR_BATTERY, &level, 1, nullptr, 0);
+}
+
+// --- EREIGNIS-LOG ---
+// Die Eingabe baut die Datensätze und reicht sie über logQueue an den
+// Haushalt. Dort landen sie erst im RAM-Puffer von eventLog; der Flash wird
+// nur beschrieben, wenn der Puffer voll ist, HK_LOG_FLUSH abläuft oder das
+// Gerät schlafen geht bzw. neu startet.
+struct HalFlash {
+    size_t sectorSize() const { return hal::logFlashSectorSize(); }
+    size_t sectorCount() const { return hal::logFlashSectors(); }
+    bool read(uint32_t addr, void* buf, size_t len) { return hal::logFlashRead(addr, buf, len); }
+    bool write(uint32_t addr, const void* data, size_t len) { return hal::logFlashWrite(addr, data, len); }
+    bool erase(uint32_t sector) { return hal::logFlashErase(sector); }
+};
+
+HalFlash halFlash;
+typedef flashlog::Log<HalFlash, LOG_STAGE_RECORDS> EventLog;
+EventLog eventLog(halFlash);
+
+static void flushLog(void*) {
+    eventLog.flush();
+}
+
+static void appendLog(const flashlog::Record& r) {
+    eventLog.append(r);
+    if (eventLog.pending() && !hkTimers.isActive(HK_LOG_FLUSH)) {
+        hkTimers.startOnce(HK_LOG_FLUSH, hal::millis(), LOG_FLUSH_INTERVAL, flushLog);
+    }
+}
+
+static void logEvent(flashlog::Event event, uint8_t arg) {
+    flashlog::Record r = {};
+    r.timeMs = hal::rtcMillis();
+    r.event = event;
+    r.arg = arg;
+    r.battery = batteryLevel.load(std::memory_order_relaxed);
+    r.conn = !deviceConnected ? flashlog::CONN_NONE : linkReady() ? flashlog::CONN_READY : flashlog::CONN_CONNECTED;
+    r.rssi = deviceConnected ? hal::bleRssi() : 0;
+    r.reserved = 0xFF;
+    logQueue.push(r);
+}
+
+// --- ADVERTISING ---
+// Ohne Verbindung nach den Phasen, neben Verbindungen langsam für weitere
+// Hosts, mit MAX_CENTRALS gar nicht. Der Stack beendet das Advertising beim
+// Verbinden, deshalb wird es nach jeder Verbindungsänderung neu gesetzt.
+static void armAdvertisingTimer();
+
+static void onAdvertisingPhase(void*) {
+    if (advertising.update(hal::millis())) {
+        LOG(MSG_ADV_PHASE, advertising.phase());
+        advertisingDirty = true;
+    }
+    armAdvertisingTimer();
+}
+
+static void armAdvertisingTimer() {
+    const uint32_t wait = advertising.timeUntilNext(hal::millis());
+    if (wait == adv::Scheduler::NO_DEADLINE) timers.cancel(TIMER_ADV_PHASE);
+    else timers.startOnce(TIMER_ADV_PHASE, hal::millis(), wait, onAdvertisingPhase);
+}
+
+// Trennung, Start, Tastendruck ohne Verbindung: wieder schnell
+static void restartAdvertisingPhases() {
+    const uint16_t before = advertising.interval();
+    advertising.restart(hal::millis());
+    if (advertising.interval() != before) advertisingDirty = true;
+    armAdvertisingTimer();
+}
+
+static void applyAdvertising() {
+    advertisingDirty = false;
+    const uint8_t connected = hal::bleConnectedCount();
+    const uint16_t interval = connected >= MAX_CENTRALS ? adv::STOP
+                              : connected > 0          ? ADV_INTERVAL_CONNECTED
+                                                       : advertising.interval();
+    hal::bleAdvertise(interval);
+    if (interval != adv::STOP && bootPhases[BOOT_ADVERTISING].load(std::memory_order_relaxed) == 0)
+        bootPhases[BOOT_ADVERTISING].store(hal::micros(), std::memory_order_relaxed);
+}
+
+static uint32_t housekeepingStep();
+
+// Vor Deep Sleep oder Neustart: der Haushalt schreibt das Flash-Log und gibt
+// alle Log-Zeilen aus (wartet dafür auf den UART), die Eingabe wartet darauf.
+static void syncHousekeeping() {
+    housekeepingSync.store(true, std::memory_order_release);
+    while (housekeepingSync.load(std::memory_order_acquire)) {
+        if (!ownTasks) {
+            housekeepingStep();
+            continue;
+        }
+        hal::wake(hal::TASK_HOUSEKEEPING);
+        hal::waitForEvent(1);
+    }
+}
+
+// --- ENERGIE ---
+// Kein Tastendruck und keine Verbindungsänderung für sleepTimeoutMs -> Deep Sleep.
+// Die Frist ist ein normaler Timer, fließt also in die Schlafdauer der loop() ein.
+static void enterDeepSleep(void*) {
+    if (buttons.stable()) {
+        noteActivity();
+        return;
+    }
+    LOG(MSG_DEEP_SLEEP);
+    logEvent(flashlog::EV_DEEP_SLEEP, 0);
+    syncHousekeeping();
+    hal::deepSleep();
+}
+
+static void noteActivity() {
+    if (config.sleepTimeoutMs > 0) timers.startOnce(TIMER_DEEP_SLEEP, hal::millis(), config.sleepTimeoutMs, enterDeepSleep);
+    else timers.cancel(TIMER_DEEP_SLEEP);
+}
+
+static void printWaitHint(void*) {
+    // Kleiner Hinweis im Monitor alle paar Sekunden
+    if (!deviceConnected) LOG(MSG_WAITING);
+}
+
+// --- ENTPRELLEN ---
+// EAGER: die erste Flanke zählt sofort, danach ist die Taste gesperrt.
+// INTEGRATOR / SHIFT: die Flanke startet nur die Abtastung, den Druck meldet
+// erst ein Tick (siehe debouncer.h). Solange eine Taste nicht zur Ruhe gekommen
+// ist, tickt TIMER_SCAN und liest alle Tasten neu.
+static void applyButtonEdges(uint32_t changed, uint32_t edgeUs);
+static void armGestureTimer();
+
+static void onScanTick(void*) {
+    const uint32_t changed = buttons.tick(hal::readButtons());
+    applyButtonEdges(changed & ~buttons.sampled(), hal::micros());
+    for (uint32_t m = changed & buttons.sampled(); m; m &= m - 1) {
+        const uint8_t bit = (uint8_t)__builtin_ctz(m);
+        applyButtonEdges(1u << bit, bounceStartUs[bit]);
+    }
+    bouncing &= buttons.locked();
+    if (!buttons.locked()) timers.cancel(TIMER_SCAN);
+}
+
+static void applyButtonEdges(uint32_t changed, uint32_t edgeUs) {
+    if (buttons.locked() && !timers.isActive(TIMER_SCAN))
+        timers.startPeriodic(TIMER_SCAN, hal::millis(), config.debounceMs / 2, onScanTick);
+    if (!changed) return;
+    noteActivity();
+    if (!deviceConnected && (changed & buttons.stable())) restartAdvertisingPhases();
+
+    const uint32_t down = buttons.stable();
+    for (uint32_t m = changed; m; m &= m - 1) {
+        const uint8_t bit = (uint8_t)__builtin_ctz(m);
+        const bool pressed = down & (1u << bit);
+        if (pressed && linkReady()) latency[STAGE_DEBOUNCED].record(hal::micros() - edgeUs);
+        gestures.onEdge((uint8_t)(bit + 1), pressed, hal::millis(), edgeUs);
+    }
+    armGestureTimer();
+}
+
+// --- GESTEN ---
+static void onGestureTimer(void*) {
+    gestures.poll(hal::millis());
+    armGestureTimer();
+}
+
+static void armGestureTimer() {
+    const uint32_t wait = gestures.timeUntilNext(hal::millis());
+    if (wait == gesture::Engine<BUTTON_COUNT>::NO_DEADLINE) timers.cancel(TIMER_GESTURE);
+    else timers.startOnce(TIMER_GESTURE, hal::millis(), wait, onGestureTimer);
+}
+
+static void onGesture(uint8_t code, uint8_t count, uint32_t edgeUs, void*) {
+    logEvent(flashlog::EV_PRESS, code);
+
+    // Ohne bereite Verbindung merken, wird beim Verbinden nachgeliefert
+    if (!linkReady()) {
+        const uint32_t edgeMs = hal::rtcMillis() - (hal::micros() - edgeUs) / 1000;
+        for (uint8_t i = 0; i < count; i++) replay.add(code, edgeMs);
+        return;
+    }
+
+    LOG(MSG_BUTTON, code & 0x0F, code);
+    queueButton(code, count, edgeUs);
+    if (!connParams.pending()) requestConnProfile(conn::PROFILE_FAST);
+    noteConnActivity();
+    blinkFeedback();
+}
+
+static void handleButtonEvent(const ButtonEvent& ev) {
+    const uint32_t changed = buttons.update(ev.mask);
+    // Erste Flanke je Taste; weiteres Prellen vor dem Tick startet nicht neu
+    const uint32_t started = buttons.locked() & buttons.sampled() & ~bouncing;
+    for (uint32_t m = started; m; m &= m - 1) bounceStartUs[__builtin_ctz(m)] = ev.timeUs;
+    bouncing |= started;
+    applyButtonEdges(changed, ev.timeUs);
+}
+
+static uint8_t* putU32(uint8_t* out, uint32_t v) {
+    out[0] = (uint8_t)v;
+    out[1] = (uint8_t)(v >> 8);
+    out[2] = (uint8_t)(v >> 16);
+    out[3] = (uint8_t)(v >> 24);
+    return out + 4;
+}
+
+static uint8_t* putU16(uint8_t* out, uint16_t v) {
+    out[0] = (uint8_t)v;
+    out[1] = (uint8_t)(v >> 8);
+    return out + 2;
+}
+
+size_t readDiagnostics(uint8_t* out, size_t maxLen) {
+    if (maxLen < DIAG_SIZE) return 0;
+    uint8_t* p = out;
+    *p++ = DIAG_VERSION;
+    *p++ = STAGE_COUNT;
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        const LatencyHistogram& h = latency[s];
+        p = putU32(p, h.count());
+        p = putU32(p, h.min());
+        p = putU32(p, h.percentile(50));
+        p = putU32(p, h.percentile(99));
+        p = putU32(p, h.max());
+    }
+    for (int i = 0; i < conn::PROFILE_COUNT; i++) {
+        const conn::Counters& c = connParams.counters((conn::Profile)i);
+        p = putU16(p, c.requested);
+        p = putU16(p, c.accepted);
+        p = putU16(p, c.rejected);
+    }
+    p = putU16(p, connParams.interval());
+    p = putU16(p, connParams.latency());
+    const uint32_t now = hal::millis();
+    *p++ = (uint8_t)advertising.count();
+    *p++ = advertising.phase();
+    p = putU32(p, advertising.lastReconnectMs());
+    for (size_t i = 0; i < adv::MAX_PHASES; i++) {
+        const adv::Counters c = advertising.counters(i, now);
+        p = putU16(p, c.entered);
+        p = putU16(p, c.connected);
+        p = putU32(p, c.activeMs);
+    }
+    for (int i = 0; i < BOOT_PHASE_COUNT; i++) p = putU32(p, bootPhaseUs((BootPhase)i));
+    p = putU32(p, buttonsLost);
+    return p - out;
+}
+
+QueueStats buttonQueueStats() { return {buttonEvents.dropped(), buttonQueuePeak, (uint32_t)buttonEvents.capacity()}; }
+
+// --- LOG-DOWNLOAD (Haushalt) ---
+// Blöcke aus ganzen Datensätzen, so groß wie die MTU erlaubt. Ist bulkQueue
+// voll, geht derselbe Block beim nächsten Tick hinein; was der Stack nicht
+// annimmt, wiederholt der TX-Task.
+bool logStreaming = false;
+bool logStreamDone = false;
+EventLog::Cursor logCursor;
+uint16_t logBlock = 0;
+uint16_t logRecordsSent = 0;
+BulkItem logChunk;
+
+static void stopLogStream() {
+    logStreaming = false;
+    hkTimers.cancel(HK_LOG_STREAM);
+}
+
+static void buildLogBlock() {
+    const size_t room = std::min((size_t)linkMtu.load(std::memory_order_relaxed) - 3, sizeof(logChunk.data));
+    size_t len = 2;
+    flashlog::Record r;
+    while (len + flashlog::SLOT_SIZE <= room && eventLog.next(logCursor, r)) {
+        memcpy(logChunk.data + len, &r, flashlog::SLOT_SIZE);
+        len += flashlog::SLOT_SIZE;
+        logRecordsSent++;
+    }
+    if (len > 2) {
+        putU16(logChunk.data, logBlock++);
+    } else {
+        putU16(putU16(logChunk.data, LOG_END_BLOCK), logRecordsSent);
+        len = 4;
+        logStreamDone = true;
+    }
+    logChunk.ch = hal::CHAR_LOG;
+    logChunk.edgeCount = 0;
+    logChunk.len = (uint16_t)len;
+}
+
+static void streamLog(void*) {
+    if (!linkUp.load(std::memory_order_relaxed)) {
+        stopLogStream();
+        return;
+    }
+    for (size_t i = 0; i < LOG_BLOCKS_PER_TICK; i++) {
+        if (logChunk.len == 0) buildLogBlock();
+        if (!bulkQueue.push(logChunk)) return;
+        if (ownTasks) hal::wake(hal::TASK_TX);
+        logChunk.len = 0;
+        if (logStreamDone) {
+            // Meldung macht die Eingabe (einziger Producer für LOG)
+            logStreamResult.store((uint32_t)logRecordsSent << 16 | logBlock, std::memory_order_release);
+            if (ownTasks) hal::wake(hal::TASK_INPUT);
+            stopLogStream();
+            return;
+        }
+    }
+}
+
+static void startLogDownload() {
+    eventLog.flush();
+    logCursor = eventLog.begin();
+    logBlock = logRecordsSent = 0;
+    logChunk.len = 0;
+    logStreamDone = false;
+    logStreaming = true;
+    hkTimers.startPeriodic(HK_LOG_STREAM, hal::millis(), LOG_STREAM_TICK_MS, streamLog);
+    streamLog(nullptr);
+}
+
+// --- KONFIGURATION ---
+static void applyGestureMaps() {
+    for (uint8_t b = 1; b <= BUTTON_COUNT && b <= cfg::MAX_BUTTONS; b++) gestures.setMap(b, config.gestureMaps[b - 1]);
+    gestures.setChord(config.chord);
+    gestures.setTiming(config.gestureTiming);
+}
+
+// Neuen Blob prüfen, speichern und übernehmen. Bei einem Fehler bleibt die
+// alte Konfiguration aktiv, der Grund steht im ersten Byte beim Lesen.
+static cfg::Error applyConfigWrite(const uint8_t* blob, size_t len) {
+    cfg::Settings next = cfg::defaults();
+    const cfg::Error err = cfg::parse(blob, len, next);
+    if (err != cfg::OK) return err;
+    macroPlayer.clear();
+    if (!buildMacros(next)) {
+        buildMacros(config);
+        return cfg::ERR_MACRO;
+    }
+    if (!hal::settingsWrite("config", blob, len)) {
+        buildMacros(config);
+        return cfg::ERR_STORAGE;
+    }
+    ConfigCopy& spare = configCopies[configCurrent.load(std::memory_order_relaxed) ^ 1];
+    memcpy(spare.data, blob, len);
+    spare.len = len;
+    configCurrent.store((uint8_t)(&spare - configCopies), std::memory_order_release);
+
+    const int8_t oldTxPower = config.txPowerDbm;
+    config = next;
+    // Entprellen: Sperrzeit hängt am Abtast-Tick, ein laufender Tick wird neu gestartet
+    buttons.setStrategies(config.debounceStrategies, cfg::MAX_BUTTONS);
+    if (timers.isActive(TIMER_SCAN)) timers.startPeriodic(TIMER_SCAN, hal::millis(), config.debounceMs / 2, onScanTick);
+    timers.startPeriodic(TIMER_BATTERY, hal::millis(), config.batteryIntervalMs, sendBattery);
+    if (config.ledBlinkMs == 0) {
+        timers.cancel(TIMER_LED_OFF);
+        hal::writeLed(ledPin, false);
+    }
+    noteActivity();
+    applyGestureMaps();
+    if (config.txPowerDbm != oldTxPower) hal::bleSetTxPower(config.txPowerDbm);
+    advertising.setPhases(config.advPhases, config.advPhaseCount);
+    if (!deviceConnected) restartAdvertisingPhases();
+    advertisingDirty = true;
+    return cfg::OK;
+}
+
+size_t readConfig(uint8_t* out, size_t maxLen) {
+    const ConfigCopy& blob = configCopies[configCurrent.load(std::memory_order_acquire)];
+    if (maxLen < 1 + blob.len) return 0;
+    out[0] = configStatus;
+    memcpy(out + 1, blob.data, blob.len);
+    return 1 + blob.len;
+}
+
+// --- FIRMWARE-UPDATE ---
+// Der BLE-Task füllt die Blockpuffer des Receivers. Steuerbefehle, Löschen
+// (~45 ms je Block), Schreiben, Zurücklesen und die Signatur rechnet der
+// Haushalt, damit Tasten nicht auf den Flash warten. Ergebnisse gehen über
+// otaReports an die Eingabe; sie meldet sie dem Host, schreibt Log und
+// Flash-Log und startet neu. Den Fortschritt liest sie aus committed().
+struct HalOta {
+    size_t capacity() const { return hal::otaCapacity(); }
+    bool erase(uint32_t offset, size_t len) { return hal::otaErase(offset, len); }
+    bool write(uint32_t offset, const void* data, size_t len) { return hal::otaWrite(offset, data, len); }
+    bool read(uint32_t offset, void* buf, size_t len) { return hal::otaRead(offset, buf, len); }
+    bool activate(size_t size) { return hal::otaActivate(size); }
+};
+
+HalOta halOta;
+ota::Receiver<HalOta> otaReceiver(halOta, OTA_PUBLIC_KEY, sizeof(OTA_PUBLIC_KEY));
+uint8_t otaCommand[ota::BEGIN_MAX_SIZE];
+size_t otaCommandLen = 0;
+std::atomic<bool> otaCommandPending{false};   // BLE-Task -> Haushalt
+
+// command 0: Flash-Fehler beim Schreiben ohne Befehl
+struct OtaReport {
+    uint8_t command;
+    uint8_t status;
+    uint32_t offset;
+};
+EventRing<OtaReport, 4> otaReports;   // Haushalt -> Eingabe
+uint32_t otaProgressSent = 0;         // nur Eingabe
+
+void onOtaCommand(const uint8_t* data, size_t len) {
+    if (len == 0 || len > sizeof(otaCommand) || otaCommandPending.load(std::memory_order_acquire)) return;
+    memcpy(otaCommand, data, len);
+    otaCommandLen = len;
+    otaCommandPending.store(true, std::memory_order_release);
+    hal::wake(hal::TASK_HOUSEKEEPING);
+}
+
+void onOtaData(const uint8_t* data, size_t len) {
+    const ota::ChunkResult r = otaReceiver.onChunk(data, len);
+    if (r == ota::CHUNK_BLOCK_READY) hal::wake(hal::TASK_HOUSEKEEPING);
+    else if (r == ota::CHUNK_REJECTED) hal::wake(hal::TASK_INPUT);
+}
+
+static void notifyOta(ota::Status status, uint32_t offset) {
+    uint8_t buf[ota::STATUS_SIZE];
+    buf[0] = status;
+    putU32(buf + 1, offset);
+    sendTx(hal::CHAR_OTA, buf, sizeof(buf), nullptr, 0);
+}
+
+static void restartNow(void*);
+
+// Haushalt: Befehl ausführen (Signatur prüfen, zurücklesen, umschalten)
+static void handleOtaCommand(const uint8_t* cmd, size_t len) {
+    uint32_t offset = otaReceiver.committed();
+    ota::Status status = ota::OTA_ERR_STATE;
+    if (cmd[0] == ota::OTA_CMD_BEGIN && len > ota::BEGIN_HEADER) {
+        status = otaReceiver.begin(ota::getU32(cmd + 1), cmd + 5, cmd + ota::BEGIN_HEADER, len - ota::BEGIN_HEADER, offset);
+    } else if (cmd[0] == ota::OTA_CMD_FINISH) {
+        status = otaReceiver.finish();
+    } else if (cmd[0] == ota::OTA_CMD_ABORT) {
+        otaReceiver.abort();
+        return;
+    }
+    otaReports.push({cmd[0], status, offset});
+}
+
+// Haushalt: Befehle und volle Blöcke; erst, wenn Platz für die Antwort ist
+static void serviceOta() {
+    if (otaReports.size() == otaReports.capacity()) return;
+    const uint32_t before = otaReceiver.committed();
+    const size_t reports = otaReports.size();
+    if (otaCommandPending.load(std::memory_order_acquire)) {
+        handleOtaCommand(otaCommand, otaCommandLen);
+        otaCommandPending.store(false, std::memory_order_release);
+    }
+    if (otaReceiver.active() && !otaReceiver.service()) otaReports.push({0, ota::OTA_ERR_FLASH, otaReceiver.committed()});
+    if (ownTasks && (otaReports.size() != reports || otaReceiver.committed() != before)) hal::wake(hal::TASK_INPUT);
+}
+
+// Eingabe: Ergebnisse melden, Fortschritt bzw. Neusenden
+static void reportOta() {
+    // Ein voller Ring hält den Haushalt an: nach dem Leeren weitermachen lassen
+    if (ownTasks && otaReports.size() == otaReports.capacity()) hal::wake(hal::TASK_HOUSEKEEPING);
+    OtaReport r;
+    while (otaReports.pop(r)) {
+        const ota::Status status = (ota::Status)r.status;
+        if (status == ota::OTA_READY) {
+            otaProgressSent = r.offset;
+            LOG(MSG_OTA_BEGIN, otaReceiver.size(), r.offset);
+            if (r.offset == 0) logEvent(flashlog::EV_OTA, status);
+            if (!connParams.pending()) requestConnProfile(conn::PROFILE_FAST);
+            noteConnActivity();
+        } else if (status == ota::OTA_DONE) {
+            LOG(MSG_OTA_DONE);
+            timers.startOnce(TIMER_RESTART, hal::millis(), MODE_RESTART_DELAY, restartNow);
+        } else if (r.command != 0) {
+            LOG(MSG_OTA_ERROR, status);
+        }
+        // Im Flash-Log: Start, Ende und Flash-Fehler, abgewiesene Signaturen
+        if ((r.command != ota::OTA_CMD_BEGIN && status != ota::OTA_READY) || status == ota::OTA_ERR_SIGNATURE)
+            logEvent(flashlog::EV_OTA, status);
+        notifyOta(status, r.offset);
+    }
+    if (!otaReceiver.active()) return;
+    // Eine Fortsetzung kann hinter dem letzten gemeldeten Stand beginnen -> nur vorwärts
+    const uint32_t done = otaReceiver.committed();
+    if (done > otaProgressSent) {
+        otaProgressSent = done;
+        notifyOta(ota::OTA_PROGRESS, done);
+        noteActivity();
+        noteConnActivity();
+    }
+    uint32_t resendAt;
+    if (otaReceiver.takeResend(resendAt)) notifyOta(ota::OTA_RESEND, resendAt);
+}
+
+static void restartNow(void*) {
+    syncHousekeeping();
+    hal::restart();
+}
+
+// --- START ---
+uint32_t bootPhaseUs(BootPhase phase) {
+    return phase < BOOT_PHASE_COUNT ? bootPhases[phase].load(std::memory_order_relaxed) : 0;
+}
+
+// Was nach dem Start des Advertisings warten kann, im Haushalt: übrige
+// Hardware, Flash-Log einhängen (liest alle Sektorköpfe), Akku-Fenster
+// füllen, Start-Datensatz. Mit begin(true) direkt in begin().
+static void finishBoot() {
+    hal::bootDeferred();
+    logMounted = eventLog.mount();
+    // Fenster einmal direkt füllen, damit der erste Akkuwert gültig ist (~100 µs)
+    while (!batterySampler.ready()) sampleBattery(nullptr);
+
+    // Start-Datensatz direkt ins Log, vor allem aus logQueue
+    flashlog::Record r = {};
+    r.timeMs = hal::rtcMillis();
+    r.event = flashlog::EV_BOOT;
+    r.arg = bootWakePress;
+    r.battery = batteryLevel.load(std::memory_order_relaxed);
+    r.conn = flashlog::CONN_NONE;
+    r.reserved = 0xFF;
+    appendLog(r);
+
+    const uint32_t now = hal::millis();
+    hkTimers.startPeriodic(HK_BATTERY_SAMPLE, now, BATTERY_SAMPLE_INTERVAL, sampleBattery);
+    housekeepingWakeAt.store(now + BATTERY_SAMPLE_INTERVAL);
+    bootPhases[BOOT_DEFERRED_DONE].store(hal::micros(), std::memory_order_relaxed);
+    bootDeferredDone.store(true, std::memory_order_release);
+}
+
+// --- ZEITABGLEICH ---
+// Der BLE-Task nimmt die Empfangszeit sofort und baut die Antwort, die
+// Eingabe reicht sie in txQueue weiter (nur sie schreibt dort hinein).
+// Volle Schlange: Anfrage verworfen, der Host wertet die Runde ohne sie aus.
+struct TimeSyncReply {
+    uint8_t data[tsync::REPLY_SIZE];
+};
+
+EventRing<TimeSyncReply, 4> timeSyncReplies;
+
+void onTimeSyncWrite(const uint8_t* data, size_t len) {
+    TimeSyncReply r;
+    if (!tsync::encodeReply(data, len, hal::micros(), r.data)) return;
+    if (timeSyncReplies.push(r)) hal::wake();
+}
+
+void begin(bool sequential) {
+    for (std::atomic<uint32_t>& t : bootPhases) t.store(0, std::memory_order_relaxed);
+    bootPhases[BOOT_BEGIN].store(hal::micros(), std::memory_order_relaxed);
+    bootDeferredPending.store(false);
+    bootDeferredDone.store(false);
+
+    uint8_t storedMode = MODE_BRIDGE;
+    if (hal::settingsRead("mode", &storedMode, 1) == 1 && storedMode < MODE_COUNT) currentMode = (Mode)storedMode;
+    requestedMode = MODE_COUNT;
+    LOG(MSG_MODE, currentMode == MODE_HID ? "HID-Tastatur" : "Bridge");
+
+    // Konfiguration: ein Blob, ein NVS-Zugriff. Ein ungültiger Blob (z.B. von
+    // einer anderen Firmware-Version) wird ignoriert, es gelten die Standardwerte.
+    config = cfg::defaults();
+    ConfigCopy& stored = configCopies[0];
+    stored.len = hal::settingsRead("config", stored.data, sizeof(stored.data));
+    if (stored.len > 0 && cfg::parse(stored.data, stored.len, config) != cfg::OK) {
+        LOG(MSG_CONFIG_INVALID);
+        stored.len = 0;
+    }
+    configCurrent.store(0, std::memory_order_release);
+    memcpy(advertisedName, config.name, sizeof(advertisedName));
+    configPending.store(false);
+    otaCommandPending.store(false);
+    otaReceiver.abort();
+    OtaReport staleOta;
+    while (otaReports.pop(staleOta)) {}
+    otaProgressSent = 0;
+    configStatus = cfg::OK;
+    macroPlayer.clear();
+    if (!buildMacros(config)) LOG(MSG_MACROS_INVALID);
+
+    hal::setupButtons();
+    hal::setupLed(ledPin);
+
+    // Nach Deep Sleep startet die Firmware neu; der Simulator ruft begin()
+    // dafür erneut auf, deshalb wird der Laufzeitzustand hier zurückgesetzt.
+    deviceConnected = wasConnected = false;
+    links.clear();
+    link::Event stale;
+    while (linkEvents.pop(stale)) {}
+    linksDirty = false;
+    buttons.reset();
+    bouncing = 0;
+    buttons.setStrategies(config.debounceStrategies, cfg::MAX_BUTTONS);
+    pendingButtons.clear();
+    pendingEdgeCount = 0;
+    backlogHead = backlogCount = 0;
+    buttonGap = false;
+    gestures.reset();
+    applyGestureMaps();
+    advertising.setPhases(config.advPhases, config.advPhaseCount);
+    logCommand = 0;
+
+    // Schlangen und Haushalt zurücksetzen (die Tasks laufen erst nach begin())
+    TxItem staleTx;
+    while (txQueue.pop(staleTx)) {}
+    BulkItem staleBulk;
+    while (bulkQueue.pop(staleBulk)) {}
+    flashlog::Record staleRecord;
+    while (logQueue.pop(staleRecord)) {}
+    txBlocked.store(false);
+    txSentTo = bulkSentTo = 0;
+    link::Table<MAX_CENTRALS> staleLinks;
+    while (linkSnapshots.pop(staleLinks)) {}
+    txLinks.clear();
+    linkUp.store(false);
+    housekeepingCommand.store(0);
+    housekeepingSync.store(false);
+    logStreamResult.store(0);
+    stopLogStream();
+    hkTimers.cancel(HK_LOG_FLUSH);
+    hkTimers.cancel(HK_BATTERY_SAMPLE);
+
+    const uint8_t wakePress = hal::wakeButton();
+    if (wakePress) {
+        LOG(MSG_WAKE_BUTTON, wakePress);
+        replay.add(wakePress, hal::wakeMillis());
+        // Die Taste ist beim Aufwachen noch gedrückt, ihr Loslassen kommt als Flanke
+        buttons.force(1u << (wakePress - 1));
+    }
+    bootWakePress = wakePress;
+    bootPhases[BOOT_INPUT_READY].store(hal::micros(), std::memory_order_relaxed);
+
+    uint32_t now = hal::millis();
+    if (sequential) {
+        finishBoot();
+    } else {
+        bootDeferredPending.store(true, std::memory_order_release);
+        housekeepingWakeAt.store(now);
+    }
+    timers.startPeriodic(TIMER_BATTERY, now, config.batteryIntervalMs, sendBattery);
+    timers.startPeriodic(TIMER_WAIT_HINT, now, WAIT_HINT_INTERVAL, printWaitHint);
+    noteActivity();
+    // Advertising startet mit dem ersten loop()-Durchlauf (BLE-Stack steht dann)
+    restartAdvertisingPhases();
+    advertisingDirty = true;
+    if (wakePress) {
+        // Pegel nach der Sperrzeit nachlesen, falls die Taste schon während des Boots losgelassen wurde
+        timers.startPeriodic(TIMER_SCAN, now, config.debounceMs / 2, onScanTick);
+    }
+
+    // Start-Signal
+    blinkFeedback();
+}
+
+// Link-Ereignisse gingen verloren (Ring voll): Die Tabelle wäre ab jetzt
+// falsch, also alles Anstehende verwerfen und den Stand vom Stack übernehmen.
+// Was danach noch ankommt, ist neuer oder ändert nichts mehr.
+static void resyncLinks() {
+    linkDropsSeen = linkEvents.dropped();
+    link::Event stale;
+    while (linkEvents.pop(stale)) {}
+    hal::BlePeer peers[MAX_CENTRALS];
+    const size_t n = hal::blePeers(peers, MAX_CENTRALS);
+    links.clear();
+    for (size_t i = 0; i < n; i++) {
+        links.apply({link::LINK_UP, peers[i].conn, 0});
+        links.apply({link::LINK_MTU, peers[i].conn, peers[i].mtu});
+        links.apply({link::LINK_SUBSCRIBE, peers[i].conn, peers[i].subscribed});
+    }
+    linksDirty = true;
+    LOG(MSG_LINK_RESYNC, links.connected());
+    noteActivity();
+    advertisingDirty = true;
+}
+
+// --- EINGABE ---
+// Eine Runde der Eingabe-Stufe, Rückgabe: ms bis zu ihrem nächsten Timer
+static uint32_t inputStep() {
+    // Verbindungen und Abos aus dem BLE-Task übernehmen
+    if (linkEvents.dropped() != linkDropsSeen) resyncLinks();
+    link::Event le;
+    while (linkEvents.pop(le)) {
+        if (!links.apply(le)) continue;
+        linksDirty = true;
+        if (le.type == link::LINK_UP || le.type == link::LINK_DOWN) {
+            LOG(MSG_CENTRALS, links.connected());
+            logEvent(le.type == link::LINK_UP ? flashlog::EV_CONNECT : flashlog::EV_DISCONNECT, (uint8_t)links.connected());
+            noteActivity();
+            advertisingDirty = true;
+        }
+    }
+    deviceConnected = links.connected() > 0;
+    linkMtu.store(links.minMtu(), std::memory_order_relaxed);
+    if (linksDirty && linkSnapshots.push(links)) linksDirty = false;
+
+    // Zeitabgleich vor allem anderen, jede Verzögerung verlängert die Umlaufzeit.
+    // Die Schranke ist etwa ein Verbindungsintervall -> schnelles Profil.
+    TimeSyncReply sync;
+    bool synced = false;
+    while (timeSyncReplies.peek(sync) && sendTx(hal::CHAR_TIME_SYNC, sync.data, sizeof(sync.data), nullptr, 0)) {
+        timeSyncReplies.pop(sync);
+        synced = true;
+    }
+    if (synced) {
+        if (!connParams.pending()) requestConnProfile(conn::PROFILE_FAST);
+        noteConnActivity();
+    }
+
+    // ROBUSTER CHECK: Verlassen wir uns nicht nur auf den Callback
+    if (hal::bleConnectedCount() > 0) {
+        if (!deviceConnected) {
+            deviceConnected = true; // Fallback, falls Callback verschluckt wurde
+            LOG(MSG_LINK_FOUND);
+        }
+    } else if (deviceConnected) {
+        deviceConnected = false;
+        links.clear();
+        linksDirty = true;
+        LOG(MSG_LINK_LOST);
+    }
+
+    if (deviceConnected != wasConnected) {
+        wasConnected = deviceConnected;
+        noteActivity();
+        advertisingDirty = true;
+        if (deviceConnected) {
+            noteConnActivity();
+            advertising.onConnected(hal::millis());
+            armAdvertisingTimer();
+        } else {
+            restartAdvertisingPhases();
+            connParams.onDisconnect();
+            timers.cancel(TIMER_CONN_IDLE);
+            timers.cancel(TIMER_CONN_REQUEST);
+        }
+    }
+
+    if (connParamsChanged) {
+        connParamsChanged = false;
+        connParams.onUpdated(connInterval, connLatency);
+        if (!connParams.pending()) timers.cancel(TIMER_CONN_REQUEST);
+        LOG(MSG_CONN_PARAMS, connParams.interval(), connParams.latency());
+    }
+
+    // Neuer Modus: speichern, GATT-Profil passt erst nach dem Neustart
+    if (requestedMode != MODE_COUNT) {
+        const uint8_t m = requestedMode;
+        requestedMode = MODE_COUNT;
+        if (m < MODE_COUNT && m != currentMode && hal::settingsWrite("mode", &m, 1)) {
+            LOG(MSG_MODE_CHANGED);
+            logEvent(flashlog::EV_MODE, m);
+            timers.startOnce(TIMER_RESTART, hal::millis(), MODE_RESTART_DELAY, restartNow);
+        }
+    }
+
+    // Neue Konfiguration aus dem BLE-Task (NVS-Schreiben blockiert kurz)
+    if (configPending.load(std::memory_order_acquire)) {
+        const cfg::Error err = applyConfigWrite(configIn, configInLen);
+        configStatus = err;
+        configPending.store(false, std::memory_order_release);
+        if (err == cfg::OK) LOG(MSG_CONFIG_APPLIED, configInLen);
+        else LOG(MSG_CONFIG_REJECTED, err);
+    }
+
+    // Firmware-Update: Antworten und Fortschritt aus dem Haushalt melden
+    reportOta();
+
+    // Log-Download bzw. Löschen macht der Haushalt (Löschen blockiert ~45 ms je Sektor)
+    if (logCommand) {
+        const uint8_t cmd = logCommand;
+        logCommand = 0;
+        if ((cmd == LOG_CMD_DOWNLOAD && deviceConnected) || cmd == LOG_CMD_ERASE) {
+            housekeepingCommand.store(cmd, std::memory_order_release);
+            if (ownTasks) hal::wake(hal::TASK_HOUSEKEEPING);
+        }
+    }
+    const uint32_t sent = logStreamResult.exchange(0, std::memory_order_acquire);
+    if (sent) LOG(MSG_LOG_SENT, sent >> 16, sent & 0xFFFF);
+
+    // Gemerkte Drücke als ein Paket nachliefern, sobald der Host zuhört
+    if (!replay.empty() && linkReady()) {
+        replay.dropOlderThan(hal::rtcMillis(), REPLAY_MAX_AGE);
+        if (replay.dropped != replayDropsLogged) {
+            const uint32_t n = replay.dropped - replayDropsLogged;
+            logEvent(flashlog::EV_REPLAY_DROPPED, n > 255 ? 255 : (uint8_t)n);
+            replayDropsLogged = replay.dropped;
+        }
+        if (!replay.empty()) LOG(MSG_REPLAY, replay.count);
+        const uint32_t nowUs = hal::micros(), nowMs = hal::rtcMillis();
+        for (uint8_t i = 0; i < replay.count; i++) {
+            const ReplayEntry& e = replay.entries[i];
+            // Gerätezeit der Flanke, damit der Host die echte Latenz sieht
+            const uint32_t edgeUs = nowUs - (nowMs - e.timeMs) * 1000;
+            if (currentMode == MODE_HID) {
+                startMacro(e.code, nowUs);
+            } else {
+                addButton(e.code, edgeUs, 1);
+            }
+        }
+        replay.clear();
+    }
+
+    // 1. Tasten-Events aus der ISR-Queue abarbeiten
+    ButtonEvent ev;
+    buttonQueuePeak = std::max<uint32_t>(buttonQueuePeak, (uint32_t)buttonEvents.size());
+    while (buttonEvents.pop(ev)) {
+        handleButtonEvent(ev);
+    }
+
+    // 2. Fällige Timer (LED, Akku, Entprellen, Hinweis)
+    timers.run(hal::millis());
+    if (advertisingDirty) applyAdvertising();
+
+    // Start fertig: Zeiten melden (LOG nur aus der Eingabe)
+    if (bootDeferredDone.exchange(false, std::memory_order_acquire)) {
+        if (!logMounted) LOG(MSG_LOG_NO_FLASH);
+        const uint32_t begun = bootPhaseUs(BOOT_BEGIN), advertised = bootPhaseUs(BOOT_ADVERTISING);
+        LOG(MSG_BOOT_TIMES, advertised ? advertised - begun : 0, bootPhaseUs(BOOT_DEFERRED_DONE) - begun);
+    }
+
+    // 3. Alles aus diesem Durchlauf in einer Notification an den TX-Task
+    if (linkReady()) flushButtons();
+    linkUp.store(deviceConnected, std::memory_order_relaxed);
+
+    // Neue Log-Zeilen und Datensätze gibt der Haushalt aus
+    if (ownTasks && (trace::pending() || !logQueue.empty())) hal::wake(hal::TASK_HOUSEKEEPING);
+    return timers.timeUntilNext(hal::millis());
+}
+
+// 4. Schlafen bis zum nächsten Timer oder bis ISR/Callback weckt.
+// Ist das Funkmodul ganz still (keine Verbindung, kein Advertising), keine
+// Taste gehalten und haben TX-Task und Haushalt nichts halb erledigt, darf der
+// Chip in Light Sleep, höchstens bis zum nächsten Haushalts-Timer. Sonst nur
+// Idle mit laufendem BLE-Stack.
+static void sleepInput(uint32_t wait) {
+    if (!buttonEvents.empty() || wait == 0) return;
+    const uint32_t now = hal::millis();
+    const uint32_t hkAt = housekeepingWakeAt.load(std::memory_order_relaxed);
+    uint32_t hkWait = TimerService<HK_TIMER_COUNT>::NO_DEADLINE;
+    if (hkAt != TimerService<HK_TIMER_COUNT>::NO_DEADLINE) hkWait = (int32_t)(hkAt - now) > 0 ? hkAt - now : 0;
+    const bool othersQuiet = txQueue.empty() && bulkQueue.empty() && housekeepingIdle.load(std::memory_order_relaxed);
+    if (!deviceConnected && !buttons.stable() && !hal::isAdvertising() && othersQuiet) hal::lightSleep(std::min(wait, hkWait));
+    else hal::waitForEvent(ownTasks ? wait : std::min(wait, hkWait));
+}
+
+// --- BLE-TX ---
+static uint32_t& sentTo(const TxItem&) { return txSentTo; }
+static uint32_t& sentTo(const BulkItem&) { return bulkSentTo; }
+
+template <class Item>
+static bool notifyItem(const Item& item, uint16_t conn) {
+    if (item.ch != hal::CHAR_TIME_SYNC) return hal::bleNotify(item.ch, conn, item.data, item.len);
+    // Sendezeit so spät wie möglich, direkt vor notify()
+    uint8_t reply[tsync::REPLY_SIZE];
+    memcpy(reply, item.data, sizeof(reply));
+    tsync::stampSend(reply, hal::micros());
+    return hal::bleNotify(item.ch, conn, reply, sizeof(reply));
+}
+
+// Einziger Aufrufer von hal::bleNotify(), je Verbindung aus der Kopie der
+// Link-Tabelle. Tasten und HID-Report nur an Abonnenten, nichts über die MTU
+// der Verbindung (die Größen richten sich nach der kleinsten, das ist nur die
+// Absicherung). Lehnt der Stack für eine Verbindung ab, bleibt das Element
+// stehen und geht beim nächsten Mal nur noch an die übrigen, so bekommt jede
+// es genau einmal. Ohne Verbindung wird verworfen. false = später erneut.
+static bool txStep() {
+    while (linkSnapshots.pop(txLinks)) {}
+    const bool done = tasks::drain(txQueue, bulkQueue, [](const auto& item) {
+        if (txLinks.connected() == 0) return true;
+        const bool needsSubscription = item.ch == hal::CHAR_BUTTON || item.ch == hal::CHAR_HID_INPUT;
+        uint32_t& sent = sentTo(item);
+        for (size_t i = 0; i < txLinks.connected(); i++) {
+            const link::Link& l = txLinks[i];
+            const uint32_t bit = 1u << (l.conn & 31);
+            if ((sent & bit) || (needsSubscription && !l.subscribed) || item.len + 3u > l.mtu) continue;
+            if (!notifyItem(item, l.conn)) return false;
+            sent |= bit;
+        }
+        sent = 0;
+        const uint32_t now = hal::micros();
+        for (size_t i = 0; i < item.edgeCount; i++) latency[STAGE_NOTIFIED].record(now - item.edgeUs[i]);
+        return true;
+    });
+    if (txBlocked.exchange(false, std::memory_order_relaxed) && ownTasks) hal::wake(hal::TASK_INPUT);
+    return done;
+}
+
+// --- HAUSHALT ---
+// Akku, Flash-Log und serielle Log-Ausgabe. Rückgabe: ms bis zum nächsten
+// eigenen Termin; TRACE_RETRY_MS, solange der UART Zeilen zurückweist.
+static uint32_t housekeepingStep() {
+    if (bootDeferredPending.exchange(false, std::memory_order_acquire)) finishBoot();
+    flashlog::Record r;
+    while (logQueue.pop(r)) appendLog(r);
+
+    serviceOta();
+
+    const uint8_t cmd = housekeepingCommand.exchange(0, std::memory_order_acquire);
+    if (cmd == LOG_CMD_DOWNLOAD) {
+        startLogDownload();
+    } else if (cmd == LOG_CMD_ERASE) {
+        stopLogStream();
+        hkTimers.cancel(HK_LOG_FLUSH);
+        eventLog.format();
+    }
+    hkTimers.run(hal::millis());
+
+    const bool sync = housekeepingSync.load(std::memory_order_acquire);
+    if (sync) eventLog.flush();
+    bool traceDone = trace::flush(hal::logWrite);
+    if (sync) {
+        while (!traceDone) {
+            hal::waitForEvent(1);
+            traceDone = trace::flush(hal::logWrite);
+        }
+        housekeepingSync.store(false, std::memory_order_release);
+        if (ownTasks) hal::wake(hal::TASK_INPUT);
+    }
+
+    const uint32_t now = hal::millis();
+    uint32_t wait = hkTimers.timeUntilNext(now);
+    if (!traceDone && wait > TRACE_RETRY_MS) wait = TRACE_RETRY_MS;
+    housekeepingWakeAt.store(wait == TimerService<HK_TIMER_COUNT>::NO_DEADLINE ? wait : now + wait, std::memory_order_relaxed);
+    housekeepingIdle.store(traceDone, std::memory_order_relaxed);
+    return wait;
+}
+
+void loop() {
+    uint32_t wait = inputStep();
+    txStep();
+    housekeepingStep();
+    // Blöcke aus dem Haushalt gleich hinterher, OTA-Antworten und Fortschritt im
+    // nächsten Durchlauf
+    if (!txStep()) wait = std::min(wait, TX_RETRY_MS);
+    if (!otaReports.empty() || (otaReceiver.active() && otaReceiver.committed() > otaProgressSent)) wait = 0;
+    sleepInput(wait);
+}
+
+void startTasks() {
+    ownTasks = true;
+}
+
+void inputTask() {
+    sleepInput(inputStep());
+}
+
+void txTask() {
+    hal::waitForEvent(txStep() ? TimerService<TIMER_COUNT>::NO_DEADLINE : TX_RETRY_MS);
+}
+
+void housekeepingTask() {
+    hal::waitForEvent(housekeepingStep());
+}
+
+}  // namespace remote
@@ -0,0 +1,137 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+// Prellverläufe für `program bounce`: Flankenfolgen eines Kontakts mit den
+// tatsächlichen Drücken als Sollwert. Keine eigenen Oszilloskop-Aufnahmen,
+// sondern nachgebaut nach veröffentlichten Messungen (Ganssle, "A Guide to
+// Debouncing": meist unter 2 ms, einzelne Schalter bis über 6 ms, Pulse bis
+// herunter auf wenige µs) und den Fehlerbildern aus dem Einsatz. Fester Seed,
+// jeder Lauf sieht dieselben Flanken.
+namespace sim {
+
+struct BounceEdge {
+    uint64_t timeUs;
+    bool pressed;
+};
+
+struct BounceTrace {
+    const char* name;
+    std::vector<BounceEdge> edges;   // aufsteigend, beginnt losgelassen
+    std::vector<uint64_t> pressUs;   // echte Drücke (erste Flanke)
+    std::vector<uint64_t> releaseUs; // zugehöriges Loslassen (erste Flanke)
+};
+
+struct ContactProfile {
+    const char* name;
+    uint32_t bounceMaxUs;      // Dauer des Prellens bei Drücken und Loslassen
+    int bouncePulsesMax;       // Flankenpaare darin
+    uint32_t holdMinMs, holdMaxMs;
+    uint32_t gapMinMs, gapMaxMs;
+    uint32_t chatterPerS;      // Aussetzer während des Haltens (abgenutzter Kontakt)
+    uint32_t spikesPerS;       // Störimpulse in Ruhe (langes Kabel)
+    uint32_t pulseMaxUs;       // Länge der Aussetzer / Störimpulse
+};
+
+// Ein Druck: Prellen nach beiden Flanken, Aussetzer beim Halten
+class TraceBuilder {
+public:
+    explicit TraceBuilder(uint32_t seed) : rng_(seed) {}
+
+    uint32_t uniform(uint32_t lo, uint32_t hi) { return std::uniform_int_distribution<uint32_t>(lo, hi)(rng_); }
+
+    void edge(uint64_t t, bool pressed) {
+        if (!trace.edges.empty() && trace.edges.back().pressed == pressed) return;
+        trace.edges.push_back({std::max(t, trace.edges.empty() ? 0 : trace.edges.back().timeUs + 1), pressed});
+    }
+
+    // Prellen nach einer Flanke zum Pegel level: Pulse in den ersten maxUs
+    void bounce(uint64_t t, bool level, uint32_t maxUs, int pulses) {
+        const int n = pulses > 0 ? (int)uniform(1, (uint32_t)pulses) : 0;
+        uint64_t at = t;
+        for (int i = 0; i < n; i++) {
+            const uint32_t step = maxUs / (uint32_t)(2 * n);
+            at += uniform(5, std::max<uint32_t>(step, 6));
+            edge(at, !level);
+            at += uniform(5, std::max<uint32_t>(step, 6));
+            edge(at, level);
+        }
+    }
+
+    void press(uint64_t at, uint32_t holdUs, const ContactProfile& p) {
+        trace.pressUs.push_back(at);
+        trace.releaseUs.push_back(at + holdUs);
+        edge(at, true);
+        bounce(at, true, p.bounceMaxUs, p.bouncePulsesMax);
+        // Aussetzer mitten im Halten, nicht im Prellen
+        const uint64_t chatter = (uint64_t)p.chatterPerS * holdUs / 1000000;
+        for (uint64_t i = 0; i < chatter; i++) {
+            const uint64_t t = at + p.bounceMaxUs + uniform(0, holdUs - 2 * p.bounceMaxUs);
+            if (t <= trace.edges.back().timeUs) continue;
+            edge(t, false);
+            edge(t + uniform(5, p.pulseMaxUs), true);
+        }
+        edge(at + holdUs, false);
+        bounce(at + holdUs, false, p.bounceMaxUs / 2, p.bouncePulsesMax / 2);
+    }
+
+    // Störimpulse in Ruhe zwischen from und to
+    void spikes(uint64_t from, uint64_t to, const ContactProfile& p) {
+        const uint64_t n = (uint64_t)p.spikesPerS * (to - from) / 1000000;
+        std::vector<uint64_t> at;
+        for (uint64_t i = 0; i < n; i++) at.push_back(from + uniform(0, (uint32_t)(to - from - p.pulseMaxUs)));
+        std::sort(at.begin(), at.end());
+        for (uint64_t t : at) {
+            if (t <= trace.edges.back().timeUs + p.pulseMaxUs) continue;
+            edge(t, true);
+            edge(t + uniform(2, p.pulseMaxUs), false);
+        }
+    }
+
+    BounceTrace trace;
+
+private:
+    std::mt19937 rng_;
+};
+
+inline BounceTrace makeTrace(const ContactProfile& p, int presses, uint32_t seed) {
+    TraceBuilder b(seed);
+    b.trace.name = p.name;
+    b.edge(0, false);
+    uint64_t t = 100000;
+    for (int i = 0; i < presses; i++) {
+        const uint32_t holdUs = b.uniform(p.holdMinMs, p.holdMaxMs) * 1000;
+        b.press(t, holdUs, p);
+        const uint64_t idleFrom = t + holdUs + p.bounceMaxUs;
+        t += holdUs + b.uniform(p.gapMinMs, p.gapMaxMs) * 1000;
+        if (p.spikesPerS) b.spikes(idleFrom, t - p.bounceMaxUs, p);
+    }
+    b.trace.edges.erase(b.trace.edges.begin());   // Startpegel, keine Flanke
+    return b.trace;
+}
+
+// Profile: Prellen, Halten, Pause, Aussetzer, Störimpulse
+const ContactProfile CONTACT_PROFILES[] = {
+    // Kurzhubtaster im Presenter: kurzes, sauberes Prellen
+    {"Taster", 1500, 4, 80, 200, 250, 600, 0, 0, 0},
+    // Mikroschalter im Fußpedal: lang und heftig
+    {"Fußschalter", 6000, 12, 150, 400, 300, 800, 0, 0, 0},
+    // Alter Clicker: oxidierte Kontakte setzen beim Halten kurz aus
+    {"Clicker alt", 3000, 6, 150, 400, 300, 800, 20, 0, 400},
+    // 3 m Kabel zum Pedal neben einem Netzteil: Störimpulse in Ruhe
+    {"Kabel/EMV", 2000, 5, 100, 300, 400, 900, 0, 8, 200},
+    // Doppeldruck so schnell wie möglich (Gesten MAP_DOUBLE)
+    {"Doppeldruck", 1500, 4, 25, 50, 20, 45, 0, 0, 0},
+};
+
+inline std::vector<BounceTrace> bounceCorpus(int presses = 200) {
+    std::vector<BounceTrace> corpus;
+    uint32_t seed = 1;
+    for (const ContactProfile& p : CONTACT_PROFILES) corpus.push_back(makeTrace(p, presses, seed++));
+    return corpus;
+}
+
+}  // namespace sim
@@ -0,0 +1,73 @@
+#pragma once
+#include <cstdint>
+#include "sim_hal.h"
+
+// Grobes Strommodell für Wemos D1 Mini32 (ESP32 + LDO + CH9102) mit LiPo.
+// Schätzwerte aus Datenblatt und Messungen mit dem USB-Messgerät, gedacht
+// für Vorher/Nachher-Vergleiche, nicht als absolute Laufzeitangabe.
+namespace sim {
+
+struct EnergyModel {
+    double cpuActiveMa = 50.0;       // CPU rechnet (240 MHz)
+    double cpuIdleMa = 12.0;         // CPU idle, Takt per DFS auf 80 MHz
+    double radioConnectedMa = 8.0;   // Mittelwert über Verbindungsintervalle
+    double advertisingEventUc = 300.0;   // Ladung je Advertising-Event (drei Kanäle inkl. Hochlaufen)
+    double lightSleepMa = 0.8;
+    double deepSleepMa = 0.15;       // ESP32 + Ruhestrom LDO/USB-Chip
+    double bootMa = 60.0;            // Neustart inkl. BLE-Init
+    double ledMa = 4.0;
+    uint32_t activeUsPerWakeup = 150;
+};
+
+// Vorher: alte loop() mit delay(10), CPU dauerhaft auf 240 MHz, nie Schlaf
+struct LegacyModel {
+    double cpuIdleMa = 30.0;
+    uint32_t wakeupIntervalUs = 10000;
+    uint32_t advertisingPeriodUs = 50000;   // NimBLE-Standard 30-60 ms + Ø 5 ms Zufall
+};
+
+struct EnergyReport {
+    double hours = 0;
+    double mAh = 0;
+    double averageMa = 0;
+    double dutyCycle = 0;   // Anteil der Zeit, in der die CPU rechnet
+};
+
+inline EnergyReport estimateEnergy(const PowerStats& s, const EnergyModel& m = EnergyModel()) {
+    const double usPerHour = 3600e6;
+    const double activeUs = (double)s.wakeups * m.activeUsPerWakeup;
+    const double awakeIdleUs = (double)(s.connectedUs + s.advertisingUs + s.radioOffUs);
+    const double totalUs = awakeIdleUs + s.lightSleepUs + s.deepSleepUs + s.bootUs;
+
+    double uAs = 0;   // mA * µs
+    uAs += activeUs * (m.cpuActiveMa - m.cpuIdleMa);   // aktive Zeit liegt in den Idle-Zeiten
+    uAs += awakeIdleUs * m.cpuIdleMa;
+    uAs += s.connectedUs * m.radioConnectedMa;
+    uAs += (double)s.advertisingEvents * m.advertisingEventUc * 1000;
+    uAs += s.lightSleepUs * m.lightSleepMa;
+    uAs += s.deepSleepUs * m.deepSleepMa;
+    uAs += s.bootUs * m.bootMa;
+    uAs += s.ledOnUs * m.ledMa;
+
+    EnergyReport r;
+    r.hours = totalUs / usPerHour;
+    r.mAh = uAs / usPerHour;
+    r.averageMa = totalUs > 0 ? uAs / totalUs : 0;
+    r.dutyCycle = totalUs > 0 ? activeUs / totalUs : 0;
+    return r;
+}
+
+// Alte Firmware für dieselbe Dauer: verbunden, solange der Host da ist, sonst Advertising
+inline EnergyReport estimateLegacyEnergy(uint64_t totalUs, uint64_t hostPresentUs,
+                                         const EnergyModel& m = EnergyModel(), const LegacyModel& l = LegacyModel()) {
+    PowerStats s;
+    s.connectedUs = hostPresentUs;
+    s.advertisingUs = totalUs - hostPresentUs;
+    s.advertisingEvents = s.advertisingUs / l.advertisingPeriodUs;
+    s.wakeups = totalUs / l.wakeupIntervalUs;
+    EnergyModel legacy = m;
+    legacy.cpuIdleMa = l.cpuIdleMa;
+    return estimateEnergy(s, legacy);
+}
+
+}  // namespace sim
@@ -0,0 +1,80 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "hal.h"
+#include "sim_hal.h"
+
+// Gegenstelle für `program link`: dekodiert Tasten- und Akku-Notifications
+// so, wie die Host-App (bridge_app.py) es tut, direkt aus den Bytes und ohne
+// packet::decode() -> ein geändertes Format der Firmware fällt hier auf.
+// Prüft die Sequenznummern je Central und zählt alles Auffällige.
+namespace sim {
+
+class HostDecoder {
+public:
+    struct Press {
+        uint64_t timeUs;     // Empfang beim Host
+        uint32_t deviceUs;   // Gerätezeit aus dem Paket (erste Flanke darin)
+        uint8_t code;
+    };
+
+    explicit HostDecoder(uint8_t central = 0) : central_(central) {}
+
+    void feed(const Notification& n) {
+        if (n.central != central_) return;
+        if (n.ch == hal::CHAR_BUTTON) button(n);
+        else if (n.ch == hal::CHAR_BATTERY) battery(n);
+    }
+
+    void feedAll(const std::vector<Notification>& all, size_t from = 0) {
+        for (size_t i = from; i < all.size(); i++) feed(all[i]);
+    }
+
+    std::vector<Press> presses;
+    std::vector<uint8_t> batteryLevels;
+    size_t buttonNotifications = 0;
+    size_t malformed = 0;
+    size_t seqGaps = 0;      // fehlende Notifications laut Sequenznummer
+    size_t seqRepeats = 0;   // doppelt oder rückwärts
+
+private:
+    // [0] Version 2, [1] n, [2..3] seq, [4..7] µs, dann n x (Code, Anzahl)
+    void button(const Notification& n) {
+        const std::vector<uint8_t>& d = n.data;
+        if (d.size() < 8 || d[0] != 2 || d[1] == 0 || d.size() != 8 + 2u * d[1]) {
+            malformed++;
+            return;
+        }
+        buttonNotifications++;
+        const uint16_t seq = (uint16_t)(d[2] | (d[3] << 8));
+        if (haveSeq_) {
+            const uint16_t step = (uint16_t)(seq - lastSeq_);
+            if (step == 0 || step > 0x8000) seqRepeats++;
+            else seqGaps += step - 1;
+        }
+        haveSeq_ = true;
+        lastSeq_ = seq;
+        const uint32_t deviceUs = (uint32_t)d[4] | ((uint32_t)d[5] << 8) | ((uint32_t)d[6] << 16) | ((uint32_t)d[7] << 24);
+        for (size_t i = 0; i < d[1]; i++) {
+            const uint8_t code = d[8 + 2 * i], count = d[9 + 2 * i];
+            if (count == 0) malformed++;
+            for (uint8_t k = 0; k < count; k++) presses.push_back({n.timeUs, deviceUs, code});
+        }
+    }
+
+    // Ein Byte Prozent
+    void battery(const Notification& n) {
+        if (n.data.size() != 1 || n.data[0] > 100) {
+            malformed++;
+            return;
+        }
+        batteryLevels.push_back(n.data[0]);
+    }
+
+    uint8_t central_;
+    bool haveSeq_ = false;
+    uint16_t lastSeq_ = 0;
+};
+
+}  // namespace sim
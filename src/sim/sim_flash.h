@@ -0,0 +1,91 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// NOR-Flash-Modell für den Simulator: Schreiben kann nur Bits löschen (1 -> 0),
+// Löschen setzt einen Sektor auf 0xFF. Zählt Schreib-/Löschvorgänge und kann
+// einen Stromausfall mitten in einem Vorgang nachstellen.
+namespace sim {
+
+class Flash {
+public:
+    enum Op { OP_WRITE, OP_ERASE };
+
+    Flash(size_t sectorSize, size_t sectorCount)
+        : sectorSize_(sectorSize), data_(sectorSize * sectorCount, 0xFF), erases_(sectorCount, 0) {}
+
+    size_t sectorSize() const { return sectorSize_; }
+    size_t sectorCount() const { return erases_.size(); }
+
+    bool read(uint32_t addr, void* buf, size_t len) {
+        if (dead_ || addr + len > data_.size()) return false;
+        std::copy(data_.begin() + addr, data_.begin() + addr + len, (uint8_t*)buf);
+        return true;
+    }
+
+    bool write(uint32_t addr, const void* src, size_t len) {
+        if (dead_ || addr + len > data_.size()) return false;
+        const size_t n = cut(OP_WRITE, len);
+        for (size_t i = 0; i < n; i++) data_[addr + i] &= ((const uint8_t*)src)[i];
+        bytesProgrammed += n;
+        writeOps++;
+        return n == len;
+    }
+
+    bool erase(uint32_t sector) {
+        if (dead_ || sector >= erases_.size()) return false;
+        const size_t n = cut(OP_ERASE, sectorSize_);
+        std::fill(data_.begin() + sector * sectorSize_, data_.begin() + sector * sectorSize_ + n, 0xFF);
+        erases_[sector]++;
+        return n == sectorSize_;
+    }
+
+    // Der (skip+1)-te Vorgang der Art op schafft nur noch bytes Bytes, danach
+    // ist der Strom weg: alle Zugriffe schlagen fehl bis powerCycle()
+    void failAfter(Op op, uint32_t skip, size_t bytes) {
+        faultArmed_ = true;
+        faultOp_ = op;
+        faultSkip_ = skip;
+        faultBytes_ = bytes;
+    }
+
+    void powerCycle() {
+        dead_ = false;
+        faultArmed_ = false;
+    }
+
+    uint32_t erases(size_t sector) const { return erases_[sector]; }
+    uint32_t totalErases() const {
+        uint32_t n = 0;
+        for (uint32_t e : erases_) n += e;
+        return n;
+    }
+
+    uint64_t bytesProgrammed = 0;
+    uint64_t writeOps = 0;
+
+private:
+    size_t cut(Op op, size_t len) {
+        if (!faultArmed_ || op != faultOp_) return len;
+        if (faultSkip_ > 0) {
+            faultSkip_--;
+            return len;
+        }
+        faultArmed_ = false;
+        dead_ = true;
+        return std::min(len, faultBytes_);
+    }
+
+    size_t sectorSize_;
+    std::vector<uint8_t> data_;
+    std::vector<uint32_t> erases_;
+    bool dead_ = false;
+    bool faultArmed_ = false;
+    Op faultOp_ = OP_WRITE;
+    uint32_t faultSkip_ = 0;
+    size_t faultBytes_ = 0;
+};
+
+}  // namespace sim
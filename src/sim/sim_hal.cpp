@@ -0,0 +1,567 @@
+#include "sim_hal.h"
+#include <algorithm>
+#include <cstdio>
+#include <deque>
+#include <map>
+#include <random>
+#include <string>
+#include "remote.h"
+#include "remote_config.h"
+
+#ifdef BUTTON_MATRIX
+#error "Der Simulator kennt nur direkt angeschlossene Tasten"
+#endif
+
+namespace sim {
+
+struct ScriptedEdge {
+    uint64_t timeUs;
+    int pin;
+    bool pressed;
+};
+
+struct HostWindow {
+    uint64_t fromUs;
+    uint64_t toUs;
+    uint32_t scanOffsetUs;   // Lage der Scanfenster
+};
+
+static const uint64_t NEVER = UINT64_MAX;
+
+static uint64_t clockUs = 0;
+static uint64_t endUs = 0;
+static bool wakePending = false;
+static bool rebootPending = false;
+static bool verboseLog = false;
+static std::vector<ScriptedEdge> edges;      // nach Zeit sortiert
+static size_t nextEdge = 0;
+static std::map<int, bool> pinPressed;
+static std::map<int, uint16_t> adcValues;
+static std::map<std::string, std::vector<uint8_t>> settings;   // NVS
+static std::vector<Notification> notified;
+static PowerStats stats;
+
+// Funk / Host. Central 0 folgt den Host-Fenstern, weitere über setConnected().
+// Connection-Handle = Index des Centrals.
+struct Central {
+    bool connected = false;
+    bool subscribed = false;
+    uint64_t subscribeAtUs = NEVER;
+};
+
+static Central centrals[MAX_CENTRALS];
+
+// Funkstrecke (LinkModel) je Central: Zustellzeiten der LL-Pakete im
+// Sendepuffer, aktuelles Verbindungs-Event und seine belegten Plätze
+struct LinkState {
+    std::deque<uint64_t> inFlight;
+    uint64_t eventUs = 0;
+    uint8_t used = 0;
+};
+
+static LinkModel link;
+static LinkStats linkCounters;
+static LinkState linkStates[MAX_CENTRALS];
+static std::mt19937 linkRng(1);
+static uint8_t connectedCount = 0;
+static std::vector<HostWindow> hostWindows;
+static std::vector<uint64_t> hostConnectTimes;
+static uint32_t subscribeUs = 150000;
+
+// Advertising und Scanner des Hosts (Standard: App scannt durchgehend)
+static uint16_t advInterval = 0;
+static uint64_t advertisingSinceUs = 0;
+static uint64_t advEventRestUs = 0;   // Zeit seit dem letzten gezählten Event
+static uint64_t discoverAtUs = UINT64_MAX;
+static Scanner scanner = {30000, 30000, 200000};
+static std::mt19937 scanRng(1);
+
+// Central-Modell Verbindungsparameter (Windows: nicht unter 15 ms)
+static uint16_t centralMinInterval = 12;
+static uint16_t centralMaxInterval = 3200;
+static uint16_t initialInterval = 24;
+static uint16_t currentInterval = 0;
+static uint16_t currentLatency = 0;
+static uint64_t paramsAtUs = NEVER;
+static uint16_t paramsInterval = 0;
+static uint16_t paramsLatency = 0;
+static uint16_t mtu = 247;
+static int8_t rssi = -60;
+static int8_t txPower = TX_POWER_DBM;
+static uint32_t settingsReadCount = 0;
+static uint32_t adcReadCount = 0;
+static Flash flash(4096, LOG_SECTORS);
+static Flash otaFlashArea(4096, 320);
+static uint32_t otaEraseUs = 45000;     // je 4-KiB-Sektor (typisch laut Datenblatt)
+static uint32_t otaWriteUsPerKiB = 2800;
+static size_t otaImageSize = 0;
+static BootCosts bootCosts;
+static uint32_t notifyCostUs = 0;
+static RadioModel* radio = nullptr;
+
+static bool ledOn = false;
+static uint8_t wakeButtonId = 0;
+static uint32_t wakeMs = 0;
+static uint32_t bootUs = 300000;
+
+enum IdleMode { IDLE_WAIT, IDLE_LIGHT_SLEEP, IDLE_DEEP_SLEEP };
+
+uint64_t nowUs() { return clockUs; }
+
+void scheduleEdge(uint64_t timeUs, int pin, bool pressed) {
+    ScriptedEdge e{timeUs, pin, pressed};
+    auto it = std::upper_bound(edges.begin() + nextEdge, edges.end(), e,
+                               [](const ScriptedEdge& a, const ScriptedEdge& b) { return a.timeUs < b.timeUs; });
+    edges.insert(it, e);
+}
+
+void schedulePress(uint64_t atUs, int pin, uint32_t holdMs, int bounceEdges) {
+    const uint64_t releaseUs = atUs + holdMs * 1000ULL;
+    scheduleEdge(atUs, pin, true);
+    for (int i = 0; i < bounceEdges; i++) {
+        scheduleEdge(atUs + 300 * (2 * i + 1), pin, false);
+        scheduleEdge(atUs + 300 * (2 * i + 2), pin, true);
+    }
+    scheduleEdge(releaseUs, pin, false);
+    for (int i = 0; i < bounceEdges; i++) {
+        scheduleEdge(releaseUs + 300 * (2 * i + 1), pin, true);
+        scheduleEdge(releaseUs + 300 * (2 * i + 2), pin, false);
+    }
+}
+
+void setAdc(int pin, uint16_t raw) { adcValues[pin] = raw; }
+
+static void subscribeDue() {
+    for (uint8_t i = 0; i < MAX_CENTRALS; i++) {
+        if (centrals[i].subscribeAtUs > clockUs) continue;
+        centrals[i].subscribeAtUs = NEVER;
+        centrals[i].subscribed = true;
+        remote::onButtonSubscribed(i, true);
+    }
+}
+
+static void setCentral(uint8_t id, bool connected) {
+    Central& c = centrals[id];
+    if (c.connected == connected) return;
+    c.connected = connected;
+    linkStates[id] = LinkState();
+    c.subscribed = false;
+    c.subscribeAtUs = connected ? clockUs + subscribeUs : NEVER;
+    connectedCount += connected ? 1 : -1;
+    if (connected) {
+        // Der Controller beendet das Advertising beim Verbinden
+        advInterval = 0;
+        discoverAtUs = NEVER;
+    }
+    remote::onConnectionChanged(id, connected);
+    if (connected) remote::onMtuChanged(id, mtu);
+    // Verbindungsparameter modelliert nur der erste bzw. letzte Central
+    if (connectedCount == (connected ? 1 : 0)) {
+        paramsAtUs = NEVER;
+        currentInterval = connected ? initialInterval : 0;
+        currentLatency = 0;
+        if (connected) remote::onConnParamsUpdated(currentInterval, currentLatency);
+    }
+}
+
+void setConnected(uint8_t count) {
+    for (uint8_t i = 0; i < MAX_CENTRALS; i++) setCentral(i, i < count);
+    subscribeDue();
+}
+
+// Mittlerer Abstand der Advertising-Events: Intervall + Ø 5 ms Zufall
+static uint64_t advPeriodUs() { return advInterval * 625ULL + 5000; }
+
+// Erstes Event ab jetzt, das der Host empfängt, plus Verbindungsaufbau
+static uint64_t findDiscovery() {
+    if (advInterval == 0 || hostWindows.empty()) return NEVER;
+    uint64_t lastEnd = 0;
+    for (const HostWindow& w : hostWindows) lastEnd = std::max(lastEnd, w.toUs);
+    std::uniform_int_distribution<uint32_t> advDelay(0, 10000);
+    uint64_t t = advertisingSinceUs;
+    for (; t < lastEnd; t += advInterval * 625ULL + advDelay(scanRng)) {
+        if (t < clockUs) continue;
+        for (const HostWindow& w : hostWindows) {
+            if (t < w.fromUs || t + scanner.connectUs >= w.toUs) continue;
+            if ((t - w.fromUs + w.scanOffsetUs) % scanner.intervalUs < scanner.windowUs) return t + scanner.connectUs;
+        }
+    }
+    return NEVER;
+}
+
+void addHostWindow(uint64_t fromUs, uint64_t toUs) {
+    hostWindows.push_back({fromUs, toUs, (uint32_t)(scanRng() % scanner.intervalUs)});
+    discoverAtUs = findDiscovery();
+}
+void setScanner(const Scanner& s) {
+    scanner = s;
+    discoverAtUs = findDiscovery();
+}
+const std::vector<uint64_t>& hostConnects() { return hostConnectTimes; }
+uint16_t advertisingInterval() { return advInterval; }
+void setSubscribeDelay(uint32_t ms) { subscribeUs = ms * 1000; }
+void setCentralIntervalRange(uint16_t minInterval, uint16_t maxInterval) {
+    centralMinInterval = minInterval;
+    centralMaxInterval = maxInterval;
+}
+void setInitialInterval(uint16_t interval) { initialInterval = interval; }
+uint16_t connInterval() { return currentInterval; }
+void setMtu(uint16_t m) { mtu = m; }
+void setLinkModel(const LinkModel& l) {
+    link = l;
+    link.lossPercent = std::min<uint8_t>(l.lossPercent, 90);
+    linkCounters = LinkStats();
+    linkRng.seed(l.seed);
+    for (LinkState& st : linkStates) st = LinkState();
+}
+const LinkStats& linkStats() { return linkCounters; }
+void setRssi(int8_t r) { rssi = r; }
+int8_t txPowerDbm() { return txPower; }
+uint32_t settingsReads() { return settingsReadCount; }
+uint32_t adcReads() { return adcReadCount; }
+Flash& logFlash() { return flash; }
+Flash& otaFlash() { return otaFlashArea; }
+void setOtaFlashTiming(uint32_t eraseUsPerSector, uint32_t writeUsPerKiB) {
+    otaEraseUs = eraseUsPerSector;
+    otaWriteUsPerKiB = writeUsPerKiB;
+}
+size_t otaActivatedSize() { return otaImageSize; }
+void setRadioModel(RadioModel* model) { radio = model; }
+void setBootTime(uint32_t us) { bootUs = us; }
+void setBootCosts(const BootCosts& costs) { bootCosts = costs; }
+void setNotifyCost(uint32_t us) { notifyCostUs = us; }
+void setVerbose(bool verbose) { verboseLog = verbose; }
+void setEndTime(uint64_t timeUs) { endUs = timeUs; }
+
+bool takeReboot() {
+    const bool r = rebootPending;
+    rebootPending = false;
+    return r;
+}
+
+const std::vector<Notification>& notifications() { return notified; }
+const PowerStats& powerStats() { return stats; }
+bool ledLit() { return ledOn; }
+
+static bool advertising() { return advInterval != 0; }
+
+// Nächster Zeitpunkt, zu dem das Host-Modell die Verbindung ändert
+static uint64_t nextLinkChange() {
+    if (hostWindows.empty()) return NEVER;
+    if (centrals[0].connected) {
+        for (const HostWindow& w : hostWindows) {
+            if (w.fromUs <= clockUs && clockUs < w.toUs) return w.toUs;
+        }
+        return clockUs;   // Host ist weg
+    }
+    return discoverAtUs;
+}
+
+static void applyLinkChange() {
+    if (!centrals[0].connected) hostConnectTimes.push_back(clockUs);
+    setCentral(0, !centrals[0].connected);
+    subscribeDue();
+}
+
+// Uhr vorstellen und die vergangene Zeit dem aktuellen Zustand zuschreiben
+static void advanceTo(uint64_t t, IdleMode mode) {
+    if (t <= clockUs) return;
+    const uint64_t dt = t - clockUs;
+    if (mode == IDLE_DEEP_SLEEP) stats.deepSleepUs += dt;
+    else if (mode == IDLE_LIGHT_SLEEP) stats.lightSleepUs += dt;
+    else if (connectedCount > 0) stats.connectedUs += dt;
+    else if (advertising()) stats.advertisingUs += dt;
+    else stats.radioOffUs += dt;
+    if (mode == IDLE_WAIT && connectedCount > 0 && advertising()) stats.connectedAdvertisingUs += dt;
+    if (mode == IDLE_WAIT && advertising()) {
+        advEventRestUs += dt;
+        stats.advertisingEvents += advEventRestUs / advPeriodUs();
+        advEventRestUs %= advPeriodUs();
+    }
+    if (ledOn) stats.ledOnUs += dt;
+    clockUs = t;
+}
+
+// ButtonId des Pins, 0 = keine Taste
+static uint8_t buttonOfPin(int pin) {
+    for (size_t i = 0; i < BUTTON_COUNT; i++)
+        if (BUTTON_KEYS.pins[i] == pin) return (uint8_t)(i + 1);
+    return 0;
+}
+
+// Alle Flanken mit Zeitpunkt <= clockUs auslösen, wie es die ISR täte
+static void fireDueEdges(bool deliver) {
+    while (nextEdge < edges.size() && edges[nextEdge].timeUs <= clockUs) {
+        const ScriptedEdge& e = edges[nextEdge++];
+        pinPressed[e.pin] = e.pressed;
+        if (deliver && buttonOfPin(e.pin)) remote::onButtonEdge(hal::readButtons(), (uint32_t)e.timeUs);
+    }
+}
+
+// Gemeinsamer Kern von waitForEvent() und lightSleep()
+static void idleFor(uint32_t timeoutMs, IdleMode mode) {
+    if (wakePending || rebootPending) {
+        wakePending = false;
+        return;
+    }
+    // Timer rechnen in ganzen ms -> Deadline liegt auf einer ms-Grenze
+    const uint64_t target = timeoutMs == 0xFFFFFFFF ? std::max(endUs, clockUs)
+                                                    : (clockUs / 1000 + timeoutMs) * 1000ULL;
+    const uint64_t edgeAt = nextEdge < edges.size() ? edges[nextEdge].timeUs : NEVER;
+    const uint64_t linkAt = nextLinkChange();
+    uint64_t subscribeAt = NEVER;
+    for (const Central& c : centrals) subscribeAt = std::min(subscribeAt, c.subscribeAtUs);
+    const uint64_t radioAt = radio ? radio->nextUs() : NEVER;
+    const uint64_t t = std::max(clockUs, std::min({target, edgeAt, linkAt, subscribeAt, paramsAtUs, radioAt}));
+    advanceTo(t, mode);
+    if (t == linkAt) applyLinkChange();
+    if (t == paramsAtUs) {
+        paramsAtUs = NEVER;
+        currentInterval = paramsInterval;
+        currentLatency = paramsLatency;
+        remote::onConnParamsUpdated(currentInterval, currentLatency);
+    }
+    subscribeDue();
+    fireDueEdges(true);
+    if (radio && radio->nextUs() <= clockUs) radio->run(clockUs);
+    wakePending = false;
+    stats.wakeups++;
+}
+
+// Die loop() steht (Flash-Zugriff), Tasten-ISRs und BLE-Task laufen weiter
+static void busyFor(uint64_t us) {
+    if (us == 0) return;
+    const uint64_t end = clockUs + us;
+    while (radio && radio->nextUs() <= end) {
+        advanceTo(std::max(clockUs, radio->nextUs()), IDLE_WAIT);
+        radio->run(clockUs);
+    }
+    advanceTo(end, IDLE_WAIT);
+    fireDueEdges(true);
+}
+
+}  // namespace sim
+
+namespace hal {
+
+using namespace sim;
+
+uint32_t millis() { return (uint32_t)(clockUs / 1000); }
+uint32_t micros() { return (uint32_t)clockUs; }
+uint32_t rtcMillis() { return (uint32_t)(clockUs / 1000); }
+
+void setupButtons() {}
+
+uint32_t readButtons() {
+    uint32_t m = 0;
+    for (size_t i = 0; i < BUTTON_COUNT; i++)
+        if (pinPressed[BUTTON_KEYS.pins[i]]) m |= 1u << i;
+    return m;
+}
+
+void setupLed(int) {}
+
+void writeLed(int, bool on) { ledOn = on; }
+
+uint16_t readAdc(int pin) {
+    adcReadCount++;
+    busyFor(bootCosts.adcReadUs);
+    return adcValues[pin];
+}
+
+uint8_t bleConnectedCount() { return connectedCount; }
+
+size_t blePeers(BlePeer* out, size_t max) {
+    size_t n = 0;
+    for (uint8_t i = 0; i < MAX_CENTRALS && n < max; i++)
+        if (centrals[i].connected) out[n++] = {i, mtu, centrals[i].subscribed};
+    return n;
+}
+
+bool isAdvertising() { return advertising(); }
+
+void bleAdvertise(uint16_t interval) {
+    advInterval = interval;
+    advertisingSinceUs = clockUs;
+    advEventRestUs = 0;
+    if (interval) stats.advertisingEvents++;   // erstes Event sofort
+    discoverAtUs = findDiscovery();
+}
+
+// LL-Pakete eines ATT-Werts in die Verbindungs-Events legen, Rückgabe:
+// Event, in dem das letzte Paket ankommt
+static uint64_t scheduleOnLink(LinkState& st, size_t packets, uint8_t perEvent) {
+    const uint64_t interval = std::max<uint64_t>(currentInterval, 6) * 1250;
+    const uint64_t next = (clockUs / interval + 1) * interval;
+    if (st.eventUs < next) {
+        st.eventUs = next;
+        st.used = 0;
+    }
+    std::uniform_int_distribution<int> percent(0, 99);
+    for (size_t i = 0; i < packets; i++) {
+        if (st.used >= perEvent) {
+            st.eventUs += interval;
+            st.used = 0;
+        }
+        while (percent(linkRng) < link.lossPercent) {
+            linkCounters.retransmissions++;
+            st.eventUs += interval;
+            st.used = 0;
+        }
+        st.used++;
+        st.inFlight.push_back(st.eventUs);
+        linkCounters.llPackets++;
+    }
+    return st.eventUs;
+}
+
+// Wie notify(data, len, connHandle) in NimBLE: ein Wert an einen Central.
+// Das Abo modelliert der Simulator nur für Tasten bzw. HID-Report.
+bool bleNotify(Characteristic ch, uint16_t conn, const uint8_t* data, size_t len) {
+    if (conn >= MAX_CENTRALS || !centrals[conn].connected) return false;
+    const bool needsSubscription = ch == CHAR_BUTTON || ch == CHAR_HID_INPUT;
+    if (needsSubscription && !centrals[conn].subscribed) return true;
+    busyFor(notifyCostUs);
+    if (!link.enabled) {
+        notified.push_back({clockUs, ch, std::vector<uint8_t>(data, data + len), (uint8_t)conn});
+        return true;
+    }
+
+    if (len > (size_t)(mtu - 3)) {
+        linkCounters.truncated++;
+        len = mtu - 3;
+    }
+    const size_t perPacket = link.llPayload - 4;   // L2CAP-Kopf; der ATT-Kopf (3) zählt zum Wert
+    const size_t packets = (len + 3 + perPacket - 1) / perPacket;
+    LinkState& st = linkStates[conn];
+    while (!st.inFlight.empty() && st.inFlight.front() <= clockUs) st.inFlight.pop_front();
+    if (st.inFlight.size() + packets > link.txBuffers) {
+        linkCounters.rejected++;
+        return false;
+    }
+    const uint64_t at = scheduleOnLink(st, packets, link.slowCentral == (int)conn ? 1 : link.packetsPerEvent);
+    notified.push_back({at, ch, std::vector<uint8_t>(data, data + len), (uint8_t)conn});
+    return true;
+}
+
+int8_t bleRssi() { return connectedCount > 0 ? rssi : 0; }
+
+void bleSetTxPower(int8_t dbm) { txPower = dbm; }
+
+void bleUpdateConnParams(uint16_t minInterval, uint16_t maxInterval, uint16_t latency, uint16_t) {
+    if (connectedCount == 0) return;
+    if (maxInterval < centralMinInterval || minInterval > centralMaxInterval) return;   // Central ignoriert
+    paramsInterval = std::max(minInterval, centralMinInterval);
+    paramsLatency = latency;
+    paramsAtUs = clockUs + 50000;
+}
+
+void waitForEvent(uint32_t timeoutMs) { idleFor(timeoutMs, IDLE_WAIT); }
+
+void lightSleep(uint32_t timeoutMs) { idleFor(timeoutMs, IDLE_LIGHT_SLEEP); }
+
+// Funk aus; ohne Reset-Callback, das Gerät ist einfach weg
+static void radioOff() {
+    connectedCount = 0;
+    for (Central& c : centrals) c = Central();
+    advInterval = 0;
+    discoverAtUs = NEVER;
+    paramsAtUs = NEVER;
+    ledOn = false;
+}
+
+// Neustart: Flanken während des Boots ändern nur den Pegel
+static void boot() {
+    stats.bootUs += bootUs;
+    stats.boots++;
+    clockUs += bootUs;
+    fireDueEdges(false);
+    rebootPending = true;
+}
+
+void deepSleep() {
+    radioOff();
+    wakeButtonId = 0;
+
+    // Bis zum nächsten Drücken schlafen (Loslassen weckt nicht). Wie auf dem
+    // ESP32 (ext0/ext1) wecken nur die ersten beiden Tasten.
+    size_t i = nextEdge;
+    for (; i < edges.size(); i++) {
+        const uint8_t button = buttonOfPin(edges[i].pin);
+        if (edges[i].pressed && (button == 1 || button == 2)) break;
+    }
+    const uint64_t wakeAt = i < edges.size() ? edges[i].timeUs : std::max(endUs, clockUs);
+    advanceTo(wakeAt, IDLE_DEEP_SLEEP);
+    if (i < edges.size()) wakeButtonId = buttonOfPin(edges[i].pin);
+    wakeMs = (uint32_t)(wakeAt / 1000);
+    boot();
+}
+
+void restart() {
+    radioOff();
+    wakeButtonId = 0;
+    boot();
+}
+
+void bootDeferred() { busyFor(bootCosts.deferredUs); }
+
+size_t settingsRead(const char* key, void* data, size_t len) {
+    settingsReadCount++;
+    busyFor(bootCosts.settingsReadUs);
+    auto it = settings.find(key);
+    if (it == settings.end()) return 0;
+    const size_t n = std::min(len, it->second.size());
+    std::copy(it->second.begin(), it->second.begin() + n, (uint8_t*)data);
+    return n;
+}
+
+bool settingsWrite(const char* key, const void* data, size_t len) {
+    settings[key].assign((const uint8_t*)data, (const uint8_t*)data + len);
+    return true;
+}
+
+size_t logFlashSectorSize() { return flash.sectorSize(); }
+size_t logFlashSectors() { return flash.sectorCount(); }
+bool logFlashRead(uint32_t addr, void* data, size_t len) {
+    busyFor(bootCosts.flashReadUs);
+    return flash.read(addr, data, len);
+}
+bool logFlashWrite(uint32_t addr, const void* data, size_t len) { return flash.write(addr, data, len); }
+bool logFlashErase(uint32_t sector) { return flash.erase(sector); }
+
+size_t otaCapacity() { return otaFlashArea.sectorSize() * otaFlashArea.sectorCount(); }
+
+bool otaErase(uint32_t offset, size_t len) {
+    const size_t sector = otaFlashArea.sectorSize();
+    for (size_t s = offset / sector; s < (offset + len) / sector; s++) {
+        busyFor(otaEraseUs);
+        if (!otaFlashArea.erase((uint32_t)s)) return false;
+    }
+    return true;
+}
+
+bool otaWrite(uint32_t offset, const void* data, size_t len) {
+    busyFor((uint64_t)len * otaWriteUsPerKiB / 1024);
+    return otaFlashArea.write(offset, data, len);
+}
+
+bool otaRead(uint32_t offset, void* data, size_t len) { return otaFlashArea.read(offset, data, len); }
+
+bool otaActivate(size_t imageSize) {
+    otaImageSize = imageSize;
+    return true;
+}
+
+uint8_t wakeButton() { return wakeButtonId; }
+uint32_t wakeMillis() { return wakeMs; }
+
+// Alle Stufen laufen in einer Schleife (remote::loop())
+void wake(Task) { wakePending = true; }
+void wakeFromISR() { wakePending = true; }
+
+bool logWrite(const char* line, size_t len) {
+    if (verboseLog) std::fwrite(line, 1, len, stdout);
+    return true;
+}
+
+}  // namespace hal
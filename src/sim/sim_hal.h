@@ -0,0 +1,173 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "hal.h"
+#include "sim_flash.h"
+
+// Simulierte Hardware für den native Build: virtuelle Uhr in µs, geskriptete
+// Tastenflanken, feste ADC-Werte, ein einfaches Host-Modell (Verbindung,
+// solange die Host-App läuft) und ein Mitschnitt aller Notifications.
+// Die Uhr läuft nur in hal::waitForEvent()/lightSleep()/deepSleep() weiter
+// -> deterministisch.
+namespace sim {
+
+struct Notification {
+    uint64_t timeUs;
+    hal::Characteristic ch;
+    std::vector<uint8_t> data;
+    uint8_t central;   // Empfänger (Connection-Handle)
+};
+
+// Zeit je Energiezustand, Grundlage für energy_model.h
+struct PowerStats {
+    uint64_t wakeups = 0;        // Rückkehr aus Idle/Schlaf in die loop()
+    uint64_t connectedUs = 0;    // Idle, Verbindung steht
+    uint64_t connectedAdvertisingUs = 0;   // davon mit langsamem Advertising für weitere Hosts
+    uint64_t advertisingUs = 0;  // Idle, Advertising läuft
+    uint64_t advertisingEvents = 0;   // gesendete Advertising-Events (je drei Kanäle)
+    uint64_t radioOffUs = 0;     // Idle ohne Funk (wach)
+    uint64_t lightSleepUs = 0;
+    uint64_t deepSleepUs = 0;
+    uint64_t bootUs = 0;         // Neustarts nach Deep Sleep
+    uint64_t ledOnUs = 0;
+    uint32_t boots = 0;
+};
+
+uint64_t nowUs();
+
+// Flanke zum Zeitpunkt timeUs (pressed = Taste gedrückt, Pin LOW)
+void scheduleEdge(uint64_t timeUs, int pin, bool pressed);
+
+// Ein kompletter Tastendruck inkl. optionalem Prellen (bounceEdges
+// zusätzliche Flankenpaare im Abstand von 0.3 ms bei Drücken und Loslassen)
+void schedulePress(uint64_t atUs, int pin, uint32_t holdMs, int bounceEdges = 0);
+
+void setAdc(int pin, uint16_t raw);
+void setVerbose(bool verbose);
+
+// Host-App läuft in [fromUs, toUs) und verbindet sich (Central 0), sobald
+// ihr Scanner ein Advertising-Event des Geräts empfängt. Ohne Fenster bleibt
+// der Zustand von setConnected().
+void addHostWindow(uint64_t fromUs, uint64_t toUs);
+
+// Scanner des Hosts: hört je intervalUs für windowUs auf einem Kanal
+// (window == interval = durchgehend). Ein Advertising-Event (alle 0.625 ms x
+// Intervall + 0-10 ms Zufall) wird empfangen, wenn es in ein Scanfenster
+// fällt; die Verbindung steht connectUs danach. Die Lage der Scanfenster
+// ist je Host-Fenster zufällig (fester Seed).
+struct Scanner {
+    uint32_t intervalUs;
+    uint32_t windowUs;
+    uint32_t connectUs;
+};
+void setScanner(const Scanner& scanner);
+// Zeitpunkte, zu denen sich Central 0 über das Host-Modell verbunden hat
+const std::vector<uint64_t>& hostConnects();
+// Zuletzt mit hal::bleAdvertise() gesetztes Intervall, 0 = kein Advertising
+uint16_t advertisingInterval();
+// Zeit vom Verbinden bis die Host-App die Tasten-Notifications bestellt
+void setSubscribeDelay(uint32_t ms);
+// Centrals 0..count-1 verbunden, alle weiteren getrennt (höchstens MAX_CENTRALS)
+void setConnected(uint8_t count);
+
+// Central-Modell für Verbindungsparameter: Anfragen werden nach 50 ms
+// angenommen, wenn sich das Intervall mit [minInterval, maxInterval]
+// überschneidet, sonst ignoriert. Start-Intervall nach dem Verbinden.
+void setCentralIntervalRange(uint16_t minInterval, uint16_t maxInterval);
+void setInitialInterval(uint16_t interval);
+uint16_t connInterval();
+
+// ATT-MTU, die der Host nach dem Verbinden aushandelt (Windows: 247)
+void setMtu(uint16_t mtu);
+
+// Funkstrecke je Central. Aus (Standard): jede Notification ist sofort beim
+// Host. An: notify() legt die LL-Pakete in den Sendepuffer der Verbindung
+// (kein Platz -> false wie NimBLE mit BLE_HS_ENOMEM). Gesendet wird in den
+// Verbindungs-Events im Abstand von connInterval(), je Event höchstens
+// packetsPerEvent Pakete. Ein verlorenes
+// Paket beendet das Event und kommt im nächsten erneut (die Link-Schicht
+// wiederholt, die Reihenfolge bleibt). ATT-Werte über llPayload - 7 Bytes
+// (L2CAP + ATT-Kopf) werden zerlegt, über MTU - 3 abgeschnitten.
+// Notification::timeUs ist dann das Event, in dem der Host den Wert vollständig hat.
+struct LinkModel {
+    bool enabled = false;
+    uint8_t packetsPerEvent = 4;
+    uint8_t txBuffers = 12;        // LL-Pakete im Controller
+    uint8_t lossPercent = 0;       // je LL-Paket, höchstens 90
+    uint8_t llPayload = 27;        // 251 mit Data Length Extension
+    int8_t slowCentral = -1;       // nimmt je Event nur ein Paket ab (z.B. Telefon im Hintergrund)
+    uint32_t seed = 1;
+};
+void setLinkModel(const LinkModel& link);
+
+struct LinkStats {
+    uint64_t llPackets = 0;        // gesendet, ohne Wiederholungen
+    uint64_t retransmissions = 0;
+    uint64_t rejected = 0;         // notify() mangels Puffer abgelehnt
+    uint64_t truncated = 0;        // Wert länger als MTU - 3
+};
+const LinkStats& linkStats();
+// Signalstärke, solange verbunden
+void setRssi(int8_t rssi);
+// Zuletzt mit hal::bleSetTxPower() gesetzte Sendeleistung
+int8_t txPowerDbm();
+// Anzahl hal::settingsRead()-Aufrufe (NVS-Zugriffe) seit Programmstart
+uint32_t settingsReads();
+// Anzahl hal::readAdc()-Aufrufe seit Programmstart
+uint32_t adcReads();
+
+// Flash-Bereich des Ereignis-Logs (hal::logFlash*), bleibt über Neustarts erhalten
+Flash& logFlash();
+
+// Zweite App-Partition für Firmware-Updates (hal::ota*), 1.25 MiB wie ota_1
+// der Standard-Partitionstabelle. Löschen und Schreiben kosten Zeit wie auf
+// dem ESP32; in dieser Zeit steht die loop(), der Funk (RadioModel) läuft weiter.
+Flash& otaFlash();
+void setOtaFlashTiming(uint32_t eraseUsPerSector, uint32_t writeUsPerKiB);
+// CPU-Zeit je hal::bleNotify() (NimBLE-Host: Mutex, mbuf, Controller-Queue).
+// Die loop() steht so lange, Tasten-ISRs laufen weiter. Standard 0.
+void setNotifyCost(uint32_t us);
+// Größe des mit hal::otaActivate() umgeschalteten Images, 0 = keins
+size_t otaActivatedSize();
+
+// Verkehr, der im BLE-Task parallel zur loop() ankommt (z.B. ein Host, der
+// ein Update streamt). nextUs(): nächster Zeitpunkt, zu dem das Modell etwas
+// tun will; run(nowUs) liefert alles Fällige über die remote::on...-Callbacks.
+// Läuft auch, während die loop() im Flash-Zugriff steht.
+class RadioModel {
+public:
+    virtual ~RadioModel() {}
+    virtual uint64_t nextUs() = 0;
+    virtual void run(uint64_t nowUs) = 0;
+};
+void setRadioModel(RadioModel* model);
+
+// Dauer eines Neustarts (Deep Sleep, hal::restart()) bis remote::begin()
+void setBootTime(uint32_t us);
+
+// Laufzeit der Zugriffe, die beim Start anfallen (µs je Aufruf, wie
+// setOtaFlashTiming() als busyFor): NVS lesen, Log-Flash lesen, ADC, und
+// hal::bootDeferred() (Serial, WLAN aus, Energieverwaltung). Standard: alles 0.
+struct BootCosts {
+    uint32_t settingsReadUs = 0;
+    uint32_t flashReadUs = 0;
+    uint32_t adcReadUs = 0;
+    uint32_t deferredUs = 0;
+};
+void setBootCosts(const BootCosts& costs);
+
+// Obergrenze der virtuellen Zeit für Wartezustände ohne Timer und Flanken
+void setEndTime(uint64_t timeUs);
+
+// true (einmalig), wenn das Gerät aus Deep Sleep aufgewacht ist oder neu
+// gestartet hat und remote::begin() wie nach einem Reset erneut laufen muss.
+// Einstellungen (hal::settingsWrite) bleiben dabei erhalten wie im NVS.
+bool takeReboot();
+
+const std::vector<Notification>& notifications();
+const PowerStats& powerStats();
+// LED gerade an (zuletzt hal::writeLed(.., true))
+bool ledLit();
+
+}  // namespace sim